@@ -1,6 +1,7 @@
 option(KN_RANDOM_USE_XOSHIRO256PLUS "Use xoroshiro256+ for pseudo-random generation" ON)
 option(KN_RANDOM_USE_SPLITMIX64 "Use splitmix64 for pseudo-random generation" OFF)
 option(KN_RANDOM_USE_STD_MT19937 "Use std marsenne twister (MT19937) for pseudo-random generation" OFF)
+option(KN_RANDOM_USE_PHILOX "Use counter-based Philox4x32-10 for pseudo-random generation" OFF)
 
 option(KN_RANDOM_SEED_USE_TIME_SPLITMIX64 "Use current time and splitmix64 to generate random seed" ON)
 option(KN_RANDOM_SEED_USE_STD "Use std::random_device to generate random seed" OFF)
@@ -12,7 +13,6 @@ function(random_src tgt)
 
         target_sources(${tgt} PRIVATE 
         "src/random/backends/xoshiro256plus.cpp"
-        "src/random/backends/ziggurat.cpp"
         )
     
         target_compile_definitions(${tgt} PRIVATE KN_RANDOM_USE_XOSHIRO256PLUS)
@@ -34,6 +34,14 @@ function(random_src tgt)
 
         target_compile_definitions(${tgt} PRIVATE KN_RANDOM_USE_STD_MT19937)    
 
+    elseif(KN_RANDOM_USE_PHILOX)
+
+        target_sources(${tgt} PRIVATE 
+        "src/random/backends/philox4x32.cpp"
+        )
+
+        target_compile_definitions(${tgt} PRIVATE KN_RANDOM_USE_PHILOX)
+
     endif()
 
     if(KN_RANDOM_SEED_USE_TIME_SPLITMIX64)
@@ -29,13 +29,11 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          const double kinetic_energy) override {
-        double chi = scattering::random_chi();
-
-        scattering::isotropic_coll(
-            projectile, id,
-            scattering::electron_elastic_vmag(kinetic_energy, chi, this->m_config.atomic_mass),
-            chi);
+                          const double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
+        const double v_mag = std::sqrt(2.0 * constants::e * kinetic_energy / constants::m_e);
+        events.scatter(id, scattering::ScatteringKind::IsotropicElastic, v_mag,
+                       2.0 * constants::m_e / this->m_config.atomic_mass);
 
         return ReactionOutcome::Collided;
     }
@@ -48,15 +46,14 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
         if (kinetic_energy < this->m_cross_section.threshold)
             return ReactionOutcome::NotCollided;
 
-        double chi = scattering::random_chi();
-        scattering::isotropic_coll(
-            projectile, id,
-            scattering::electron_excitation_vmag(kinetic_energy, this->m_cross_section.threshold),
-            chi);
+        events.scatter(
+            id, scattering::ScatteringKind::Isotropic,
+            scattering::electron_excitation_vmag(kinetic_energy, this->m_cross_section.threshold));
         return ReactionOutcome::Collided;
     }
 };
@@ -74,34 +71,27 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
         if (kinetic_energy < this->m_cross_section.threshold)
             return ReactionOutcome::NotCollided;
 
-        projectile.add_copy(id);
-        size_t p_idx_new = projectile.n() - 1;
-
-        auto event_pos = projectile.x()[id];
+        const auto event_pos = projectile.x()[id];
 
-        double ion_mass = ions_->m();
-        double neutral_temperature = t_neutral_;
-        double v_mag =
+        const double v_mag =
             scattering::electron_ionization_vmag(kinetic_energy, this->m_cross_section.threshold);
 
-        double chi1 = scattering::random_chi();
-        scattering::isotropic_coll(projectile, id, v_mag, chi1);
+        events.scatter(id, scattering::ScatteringKind::Isotropic, v_mag);
 
-        // Generated electron
-        double chi2 = scattering::random_chi();
-        scattering::isotropic_coll(projectile, p_idx_new, v_mag, chi2);
+        // Generated electron, an isotropic deflection of the incident direction being isotropic
+        const auto vs = scattering::isotropic_direction();
+        events.create(projectile, event_pos, {vs.x * v_mag, vs.y * v_mag, vs.z * v_mag});
 
         // Generated ion
-        ions_->add(1, [event_pos, ion_mass, neutral_temperature](core::Vec<3>& v,
-                                                                 core::Vec<NX>& x) {
-            x = event_pos;
-            const double v_th = std::sqrt(spark::constants::kb * neutral_temperature / ion_mass);
-            v = {random::normal(0.0, v_th), random::normal(0.0, v_th), random::normal(0.0, v_th)};
-        });
+        const double v_th = std::sqrt(spark::constants::kb * t_neutral_ / ions_->m());
+        events.create(*ions_, event_pos,
+                      {random::normal(0.0, v_th), random::normal(0.0, v_th),
+                       random::normal(0.0, v_th)});
 
         return ReactionOutcome::Collided;
     }
@@ -118,13 +108,10 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
-        const double chi = scattering::random_chi2();
-        const double cos_chi = std::cos(chi);
-        const double v_mag =
-            std::sqrt(2.0 * constants::e * (kinetic_energy * cos_chi * cos_chi) / projectile.m());
-
-        scattering::isotropic_coll(projectile, id, v_mag, chi);
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
+        const double v_mag = std::sqrt(2.0 * constants::e * kinetic_energy / projectile.m());
+        events.scatter(id, scattering::ScatteringKind::EqualMassElastic, v_mag);
 
         return ReactionOutcome::Collided;
     }
@@ -142,17 +129,21 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
+        // tan chi = sqrt(r (1 - r)) / ((gamma + 1) / 2 - r), with chi in (-pi/2, pi/2) so that
+        // cos chi is positive. The sign of sin chi only turns the azimuth, which is uniform.
         const double r = random::uniform();
-        const double chi = atan(sqrt(r * (1 - r)) / ((gamma_ + 1) / 2 - r));
-        const double cc = cos(chi);
-        double efactor = ((cc + sqrt(cc * cc + 3)) / 3);
+        const double a = std::sqrt(r * (1.0 - r));
+        const double b = 0.5 * (gamma_ + 1.0) - r;
+        const double cc = std::abs(b) / std::sqrt(a * a + b * b);
+        double efactor = ((cc + std::sqrt(cc * cc + 3)) / 3);
         efactor *= efactor;
 
         const double v_mag =
             std::sqrt(2.0 * constants::e * (kinetic_energy * efactor) / projectile.m());
 
-        scattering::isotropic_coll(projectile, id, v_mag, chi);
+        events.scatter(id, scattering::ScatteringKind::GivenAngle, v_mag, cc);
 
         return ReactionOutcome::Collided;
     }
@@ -168,9 +159,10 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
         // Zero since this is going to go back to the target ref frame
-        projectile.v()[id] = core::Vec<3>();
+        events.replace_velocity(id, core::Vec<NV>());
         return ReactionOutcome::Collided;
     }
 };
@@ -188,17 +180,12 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
-        const auto event_pos = projectile.x()[id];
-        const double ion_mass = target_species_->m();
-        const double neutral_temperature = t_neutral_;
-
-        target_species_->add(1, [event_pos, ion_mass, neutral_temperature](core::Vec<3>& v,
-                                                                           core::Vec<NX>& x) {
-            x = event_pos;
-            const double v_th = std::sqrt(spark::constants::kb * neutral_temperature / ion_mass);
-            v = {random::normal(0.0, v_th), random::normal(0.0, v_th), random::normal(0.0, v_th)};
-        });
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
+        const double v_th = std::sqrt(spark::constants::kb * t_neutral_ / target_species_->m());
+        events.create(*target_species_, projectile.x()[id],
+                      {random::normal(0.0, v_th), random::normal(0.0, v_th),
+                       random::normal(0.0, v_th)});
 
         return ReactionOutcome::Collided | ReactionOutcome::ProjectileToBeRemoved;
     }
@@ -221,16 +208,12 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
-        auto event_pos = projectile.x()[id];
-        double ion_temp = t_neutral_;
-        double ion_mass = target_species_->m();
-
-        target_species_->add(1, [event_pos, ion_mass, ion_temp](core::Vec<3>& v, core::Vec<NX>& x) {
-            x = event_pos;
-            const double v_th = std::sqrt(spark::constants::kb * ion_temp / ion_mass);
-            v = {random::normal(0.0, v_th), random::normal(0.0, v_th), random::normal(0.0, v_th)};
-        });
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
+        const double v_th = std::sqrt(spark::constants::kb * t_neutral_ / target_species_->m());
+        events.create(*target_species_, projectile.x()[id],
+                      {random::normal(0.0, v_th), random::normal(0.0, v_th),
+                       random::normal(0.0, v_th)});
 
         return ReactionOutcome::Collided | ReactionOutcome::ProjectileToBeRemoved;
     }
@@ -247,7 +230,8 @@ public:
 
     ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                           size_t id,
-                          double kinetic_energy) override {
+                          double kinetic_energy,
+                          ReactionEvents<NX, NV>& events) override {
         return ReactionOutcome::Collided | ReactionOutcome::ProjectileToBeRemoved;
     }
 };
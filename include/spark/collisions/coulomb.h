@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "spark/particle/cell_index.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+#include "spark/spatial/grid.h"
+
+namespace spark::collisions {
+
+enum class CoulombKernel { TakizukaAbe, Nanbu };
+
+struct CoulombConfig {
+    double dt;
+    // Number of real particles represented by each particle, which gives the density of a cell in
+    // the scattering angle. Per unit length or area of the unresolved dimensions when NX < 3.
+    double weight;
+    double coulomb_log = 10.0;
+    // Takizuka and Abe, J. Comput. Phys. 25, 205 (1977) or Nanbu, Phys. Rev. E 55, 4642 (1997)
+    CoulombKernel kernel = CoulombKernel::Nanbu;
+    // Processes the cells in chunks on multiple threads
+    bool parallel = false;
+};
+
+// Binary Coulomb collisions between particles of the same cell. The species are sorted by cell
+// and the particles of each cell are randomly paired, so that every particle collides once per
+// step and the cost is linear in the number of particles.
+template <unsigned NX, unsigned NV>
+class CoulombCollisions {
+public:
+    CoulombCollisions(const spatial::GridProp<NX>& grid, const CoulombConfig& config);
+
+    // Collisions of a species with itself
+    void collide(particle::ChargedSpecies<NX, NV>& species);
+
+    // Collisions between two different species
+    void collide(particle::ChargedSpecies<NX, NV>& a, particle::ChargedSpecies<NX, NV>& b);
+
+private:
+    struct Pairs;
+
+    void collide_cells(particle::ChargedSpecies<NX, NV>& a,
+                       particle::ChargedSpecies<NX, NV>* b,
+                       size_t begin,
+                       size_t end);
+    void apply(particle::ChargedSpecies<NX, NV>& a,
+               particle::ChargedSpecies<NX, NV>& b,
+               Pairs& pairs) const;
+    CoulombConfig config_;
+    particle::CellIndex<NX, NV> index_a_;
+    particle::CellIndex<NX, NV> index_b_;
+    random::StreamPool streams_;
+};
+
+}  // namespace spark::collisions
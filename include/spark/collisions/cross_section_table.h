@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "spark/collisions/reaction.h"
+
+namespace spark::collisions {
+
+// Linear interpolation of a tabulated cross section, clamped to the first and last values
+double interpolate_cross_section(const CrossSection& cs, double energy);
+
+enum class EnergyGridType { Uniform, LogUniform };
+
+struct CrossSectionTableConfig {
+    EnergyGridType grid = EnergyGridType::Uniform;
+    // Initial number of energy points, doubled until max_error or max_points is reached
+    size_t n_points = 1024;
+    size_t max_points = 1 << 16;
+    // Maximum absolute error of the cumulative cross sections, relative to the maximum total
+    // cross section
+    double max_error = 1e-3;
+};
+
+// Cross sections of a reaction set resampled onto a single energy grid. Each grid point stores the
+// cumulative cross sections of all reactions contiguously, so that a lookup is one index
+// computation and a linear interpolation between two neighbouring rows.
+class CrossSectionTable {
+public:
+    struct Point {
+        const double* row = nullptr;
+        double w = 0.0;
+    };
+
+    CrossSectionTable() = default;
+
+    // The cross sections are evaluated at energy_scale * energy for a given energy
+    CrossSectionTable(const std::vector<const CrossSection*>& cross_sections,
+                      double energy_scale,
+                      const CrossSectionTableConfig& config = {});
+
+    // Fractional position of energy in the grid, clamped to [0, n_points - 1]
+    double index(double energy) const {
+        double x;
+        if (grid_ == EnergyGridType::Uniform)
+            x = (energy - e0_) * inv_de_;
+        else
+            x = energy > 0.0 ? (std::log(energy) - e0_) * inv_de_ : 0.0;
+
+        const auto x_max = static_cast<double>(n_points_ - 1);
+        return x < 0.0 ? 0.0 : (x < x_max ? x : x_max);
+    }
+
+    Point at(double energy) const {
+        const double x = index(energy);
+        auto i = static_cast<size_t>(x);
+        i = i < n_points_ - 1 ? i : n_points_ - 2;
+
+        const double w = x - static_cast<double>(i);
+        return {data_.data() + i * n_reactions_, w};
+    }
+
+    // Sum of the cross sections of reactions [0, r] at p
+    double cumulative(const Point& p, size_t r) const {
+        const double c0 = p.row[r];
+        return c0 + p.w * (p.row[r + n_reactions_] - c0);
+    }
+
+    double total(const Point& p) const { return cumulative(p, n_reactions_ - 1); }
+
+    // Sum of the cross sections of reactions [0, r] and total cross section at grid point i
+    double cumulative(size_t i, size_t r) const { return data_[i * n_reactions_ + r]; }
+    double total(size_t i) const { return cumulative(i, n_reactions_ - 1); }
+
+    size_t n_points() const { return n_points_; }
+    size_t n_reactions() const { return n_reactions_; }
+    double energy(size_t i) const;
+    double error() const { return error_; }
+
+private:
+    void build(const std::vector<const CrossSection*>& cross_sections, size_t n_points);
+    double eval_error(const std::vector<const CrossSection*>& cross_sections) const;
+
+    EnergyGridType grid_ = EnergyGridType::Uniform;
+    double energy_scale_ = 1.0;
+    double e_min_ = 0.0, e_max_ = 0.0;
+    double e0_ = 0.0, inv_de_ = 0.0;
+    size_t n_points_ = 0;
+    size_t n_reactions_ = 0;
+    double error_ = 0.0;
+    std::vector<double> data_;
+};
+
+}  // namespace spark::collisions
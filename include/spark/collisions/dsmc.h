@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "spark/particle/cell_index.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+#include "spark/spatial/grid.h"
+
+namespace spark::collisions {
+
+// Variable soft sphere molecules (G. A. Bird, Molecular Gas Dynamics and the Direct Simulation of
+// Gas Flows, 1994). alpha = 1 gives variable hard spheres and additionally omega = 0.5 hard
+// spheres.
+struct VSSModel {
+    // Diameter [m] at the reference temperature
+    double d_ref = 0.0;
+    double t_ref = 273.0;
+    // Temperature exponent of the viscosity
+    double omega = 0.5;
+    // Exponent of the deflection angle distribution
+    double alpha = 1.0;
+};
+
+struct DSMCConfig {
+    double dt;
+    // Number of real molecules represented by each particle, which scales the number of candidate
+    // pairs of a cell. Per unit length or area of the unresolved dimensions when NX < 3.
+    double weight;
+    VSSModel model;
+    // The (sigma g)_max of every cell starts at twice the mean relative speed of a gas at this
+    // temperature and is raised whenever a pair exceeds it
+    double initial_temperature = 300.0;
+    // Processes the cells in chunks on multiple threads
+    bool parallel = false;
+};
+
+// Binary collisions of a species with itself using the No-Time-Counter scheme. The particles are
+// sorted by cell each step and the candidate pairs of a cell are selected from its contiguous
+// range.
+template <unsigned NX, unsigned NV>
+class DSMCCollisions {
+public:
+    DSMCCollisions(particle::Species<NX, NV>* species,
+                   const spatial::GridProp<NX>& grid,
+                   const DSMCConfig& config);
+
+    void collide();
+
+    // Total cross section times relative speed for a relative speed g
+    double sigma_g(double g) const;
+
+    size_t n_collisions() const { return n_collisions_; }
+    const particle::CellIndex<NX, NV>& cell_index() const { return cell_index_; }
+
+private:
+    size_t collide_cells(size_t begin, size_t end);
+    void collide_pair(core::Vec<NV>& v1, core::Vec<NV>& v2) const;
+
+    particle::Species<NX, NV>* species_ = nullptr;
+    DSMCConfig config_;
+    particle::CellIndex<NX, NV> cell_index_;
+
+    double sigma_g_factor_ = 0.0;
+    double pair_factor_ = 0.0;
+    std::vector<double> sigma_g_max_;
+
+    random::StreamPool streams_;
+    std::vector<size_t> chunk_collisions_;
+    size_t n_collisions_ = 0;
+};
+
+}  // namespace spark::collisions
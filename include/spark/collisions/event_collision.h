@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "spark/collisions/cross_section_table.h"
+#include "spark/collisions/null_collision.h"
+#include "spark/collisions/reaction.h"
+#include "spark/constants/constants.h"
+#include "spark/particle/cell_index.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+#include "spark/spatial/grid.h"
+
+namespace spark::collisions {
+
+template <unsigned NX, unsigned NV>
+struct EventCollisionConfig {
+    double dt;
+    // See NullCollisionConfig
+    RelativeDynamics dyn;
+    CrossSectionTableConfig table = {};
+    // Buckets of the calendar queue, each holding the candidates of one time step. Candidates
+    // further ahead stay in their bucket until it comes around again.
+    size_t n_buckets = 1024;
+    // Kinetic energy [eV] up to which the majorant bounds the collision frequency, the end of the
+    // table when 0. Faster particles collide with at most one reaction per candidate and are
+    // undersampled.
+    double max_energy = 0.0;
+    // Cells of the source map of the counters, which is not recorded when empty
+    std::optional<spatial::GridProp<NX>> source_grid = {};
+};
+
+// Event-driven null-collision Monte Carlo. Each particle of the projectile species carries the
+// time of its next collision candidate, drawn from a single majorant collision frequency that
+// bounds all energies and positions, and the candidates are kept in a calendar queue with one
+// bucket per time step. A step only visits the candidates of its bucket, so its cost scales with
+// the number of candidates instead of the number of particles, which pays off at low collision
+// probabilities per step. The projectile species stores the times as its collision times
+// component, so they follow the particles through additions, removals and sorting.
+template <unsigned NX, unsigned NV>
+class EventCollisionSampler {
+public:
+    EventCollisionSampler() = default;
+    EventCollisionSampler(particle::ChargedSpecies<NX, NV>* projectile,
+                          const std::vector<NullCollisionTarget<NX, NV>>& targets,
+                          const EventCollisionConfig<NX, NV>& config);
+
+    // Processes the candidates due in the current time step and calls
+    // react(reaction, id, kinetic_energy, events) for those that collide, as
+    // NullCollisionSampler::react_all
+    template <typename React>
+    void react_all(React&& react);
+
+    const CrossSectionTable& table() const { return mixture_.table(); }
+    const EventCollisionConfig<NX, NV>& config() const { return config_; }
+
+    // Majorant collision frequency [1/s]
+    double majorant() const { return nu_prime_; }
+
+    MCCCounters counters() const { return counters_; }
+    void reset_counters() { counters_.clear(); }
+
+private:
+    struct Candidate {
+        size_t id;
+        double time;
+    };
+
+    template <typename React>
+    void collide(size_t id, React& react);
+    void update_majorant();
+    void schedule_changes();
+    void schedule(size_t id);
+    void apply_events();
+
+    // Times are in time steps, step n covering [n, n + 1)
+    double next_time(double time) const {
+        return time - std::log(1.0 - random::uniform()) / (nu_prime_ * config_.dt);
+    }
+
+    std::vector<Candidate>& bucket_of(double time) {
+        return buckets_[static_cast<uint64_t>(time) % buckets_.size()];
+    }
+
+    double kinetic_energy(size_t idx) const {
+        const auto& v = projectile_->v()[idx];
+        return 0.5 * projectile_->m() * (v.x * v.x + v.y * v.y + v.z * v.z) / constants::e;
+    }
+
+    // Growth of the majorant when a varying target exceeds it, which reschedules all particles
+    static constexpr double majorant_headroom_ = 1.25;
+
+    particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
+    EventCollisionConfig<NX, NV> config_;
+    MixtureTable<NX, NV> mixture_;
+
+    // Bound of sigma * v of each target over all energies up to max_energy, and the share of each
+    // target in the majorant
+    std::vector<double> sigma_v_max_;
+    std::vector<double> target_nu_prime_;
+    double nu_prime_ = 0.0;
+
+    uint64_t step_ = 0;
+    std::vector<std::vector<Candidate>> buckets_;
+    std::vector<Candidate> due_;
+    std::vector<Candidate> round_;
+    std::vector<size_t> changed_;
+
+    ReactionEvents<NX, NV> events_;
+    DeferredCollisions<NX, NV> deferred_;
+    MCCCounters counters_;
+    std::optional<particle::CellIndex<NX, NV>> source_cells_;
+};
+
+template <unsigned NX, unsigned NV>
+template <typename React>
+void EventCollisionSampler<NX, NV>::react_all(React&& react) {
+    update_majorant();
+    schedule_changes();
+
+    // Entries whose particle was removed, replaced or rescheduled since are stale and dropped
+    const double step_end = static_cast<double>(step_ + 1);
+    auto& bucket = buckets_[step_ % buckets_.size()];
+    const auto* times = projectile_->collision_times();
+
+    due_.clear();
+    size_t n_kept = 0;
+    for (const auto& candidate : bucket) {
+        if (candidate.id >= projectile_->n() || times[candidate.id] != candidate.time)
+            continue;
+
+        if (candidate.time < step_end)
+            due_.push_back(candidate);
+        else
+            bucket[n_kept++] = candidate;
+    }
+    bucket.resize(n_kept);
+
+    // A particle may collide again within the step, in which case it is due again in the next
+    // round, after the scatterings of the current one are applied
+    events_.clear();
+    while (!due_.empty()) {
+        round_.swap(due_);
+        due_.clear();
+        for (const auto& candidate : round_)
+            collide(candidate.id, react);
+        deferred_.flush(*projectile_, source_cells_ ? &*source_cells_ : nullptr, events_,
+                        counters_);
+    }
+
+    apply_events();
+    ++step_;
+}
+
+template <unsigned NX, unsigned NV>
+template <typename React>
+void EventCollisionSampler<NX, NV>::collide(const size_t id, React& react) {
+    core::Vec<3> v_random;
+    const double m = projectile_->m();
+    const bool slow_projectile = config_.dyn == RelativeDynamics::SlowProjectile;
+
+    // As in NullCollisionSampler, slow projectiles collide with a target selected by its share of
+    // the majorant, in the rest frame of one of its particles
+    size_t target = 0;
+    double nu_prime = nu_prime_;
+    if (slow_projectile) {
+        double r0 = random::uniform() * nu_prime_;
+        while (target + 1 < target_nu_prime_.size() && r0 >= target_nu_prime_[target])
+            r0 -= target_nu_prime_[target++];
+        nu_prime = target_nu_prime_[target];
+
+        auto& vp = projectile_->v()[id];
+        const double vth = std::sqrt(constants::kb * mixture_.target(target).temperature() / m);
+        v_random = {random::normal() * vth, random::normal() * vth, random::normal() * vth};
+        vp.x -= v_random.x;
+        vp.y -= v_random.y;
+        vp.z -= v_random.z;
+    }
+
+    const double energy = kinetic_energy(id);
+    const double r1 = random::uniform();
+    const double v_over_nu = std::sqrt(2.0 * constants::e * energy / m) / nu_prime;
+    const auto& x = projectile_->x()[id];
+    const auto point = table().at(energy);
+    const size_t r = slow_projectile ? mixture_.select_in(target, x, point, r1, v_over_nu)
+                                     : mixture_.select(x, point, r1, v_over_nu);
+
+    auto outcome = ReactionOutcome::NotCollided;
+    if (r < table().n_reactions()) {
+        [[maybe_unused]] const size_t first_created = events_.created.size();
+        outcome = react(r, id, energy, events_);
+        if (static_cast<bool>(outcome & ReactionOutcome::ProjectileToBeRemoved))
+            events_.removed.push_back(id);
+
+#ifdef SPARK_ENABLE_MCC_COUNTERS
+        if (static_cast<bool>(outcome & ReactionOutcome::Collided))
+            deferred_.collisions.push_back(
+                {r, id, energy, outcome, first_created, events_.created.size()});
+#endif
+    }
+
+#ifdef SPARK_ENABLE_MCC_COUNTERS
+    counters_.candidates++;
+    if (!static_cast<bool>(outcome & ReactionOutcome::Collided))
+        counters_.null_events++;
+#endif
+
+    if (slow_projectile)
+        deferred_.frames.emplace_back(id, v_random);
+
+    if (static_cast<bool>(outcome & ReactionOutcome::ProjectileToBeRemoved))
+        return;
+
+    auto& time = projectile_->collision_times()[id];
+    time = next_time(time);
+    if (time < static_cast<double>(step_ + 1))
+        due_.push_back({id, time});
+    else
+        bucket_of(time).push_back({id, time});
+}
+
+}  // namespace spark::collisions
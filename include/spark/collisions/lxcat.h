@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "spark/collisions/reaction.h"
+#include "spark/particle/species.h"
+
+namespace spark::collisions {
+
+enum class LXCatProcessType : uint32_t { Elastic, Effective, Excitation, Ionization, Attachment };
+
+// One process of an LXCat file. Energies are in eV and cross sections in m^2. The views point into
+// the storage of the LXCatDatabase they come from.
+struct LXCatProcess {
+    LXCatProcessType type = LXCatProcessType::Elastic;
+    // Species line of the process, e.g. "Ar" or "Ar -> Ar*(11.55eV)"
+    std::string_view species;
+    // Text of the PROCESS: line, empty if there is none
+    std::string_view process;
+    // Electron to target mass ratio, only given for elastic and effective processes
+    double mass_ratio = 0.0;
+    // Energy loss of excitation and ionization processes
+    double threshold = 0.0;
+    std::span<const double> energy;
+    std::span<const double> cross_section;
+
+    CrossSection to_cross_section() const {
+        return {threshold, {energy.begin(), energy.end()},
+                {cross_section.begin(), cross_section.end()}};
+    }
+};
+
+// Cross sections read from LXCat files (also used for the Biagi database exports). The processes
+// are stored in a single block with the layout of the binary cache, which is either owned or
+// memory mapped read-only from a cache file, so that all processes on a node share one copy.
+class LXCatDatabase {
+public:
+    // Increased whenever the layout of the cache changes, which invalidates existing files
+    static constexpr uint32_t cache_version = 1;
+
+    LXCatDatabase() = default;
+    LXCatDatabase(LXCatDatabase&& other) noexcept;
+    LXCatDatabase& operator=(LXCatDatabase&& other) noexcept;
+    LXCatDatabase(const LXCatDatabase&) = delete;
+    LXCatDatabase& operator=(const LXCatDatabase&) = delete;
+    ~LXCatDatabase();
+
+    static LXCatDatabase parse(std::istream& in);
+
+    // Parses an LXCat text file, empty if it cannot be read
+    static LXCatDatabase load(const std::string& path);
+
+    // Maps the binary cache of path. If the cache is missing, from another version or older than
+    // path, the text file is parsed and the cache rewritten first. The cache is replaced
+    // atomically, so concurrent processes can load the same files.
+    static LXCatDatabase load_cached(const std::string& path, const std::string& cache_path);
+
+    bool write_cache(const std::string& cache_path) const;
+
+    const std::vector<LXCatProcess>& processes() const { return processes_; }
+    bool empty() const { return processes_.empty(); }
+    bool mapped() const { return map_ != nullptr; }
+
+private:
+    static LXCatDatabase from_storage(std::vector<uint64_t>&& storage);
+    bool read_layout(const std::byte* data, size_t size);
+    bool map(const std::string& cache_path);
+    void release();
+
+    std::vector<LXCatProcess> processes_;
+    std::vector<uint64_t> storage_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+
+    // Size and modification time of the parsed text file, used to detect stale caches
+    uint64_t source_size_ = 0;
+    int64_t source_mtime_ = 0;
+};
+
+template <unsigned NX, unsigned NV>
+struct LXCatReactionsConfig {
+    // Mass of the target atoms in kg. With 0 it is obtained from the mass ratio of the elastic
+    // process.
+    double target_mass = 0.0;
+    // Species receiving the ions created by ionization, which is skipped when null
+    particle::ChargedSpecies<NX, NV>* ions = nullptr;
+    double t_neutral = 300.0;
+    // Only processes whose species line starts with target are used, all of them if empty
+    std::string target;
+};
+
+// Electron impact reactions for the processes of a database. Elastic processes become elastic
+// collisions, excitations and ionizations the respective collisions and attachments remove the
+// electron. Effective processes become elastic collisions with the effective cross section minus
+// the inelastic processes of the same target that are used, clamped at 0.
+template <unsigned NX, unsigned NV>
+Reactions<NX, NV> make_electron_reactions(const LXCatDatabase& database,
+                                          const LXCatReactionsConfig<NX, NV>& config);
+
+}  // namespace spark::collisions
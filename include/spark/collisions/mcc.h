@@ -1,23 +1,29 @@
 #pragma once
 
 #include <memory>
-#include <unordered_set>
+#include <optional>
 #include <vector>
 
 #include "reaction.h"
+#include "spark/collisions/event_collision.h"
+#include "spark/collisions/null_collision.h"
 #include "spark/collisions/target.h"
 #include "spark/particle/species.h"
 
 namespace spark::collisions {
 
-enum class RelativeDynamics { SlowProjectile, FastProjectile };
-
 template <unsigned NX, unsigned NV>
 struct ReactionConfig {
     double dt;
     std::shared_ptr<Target<NX, NV>> target;
     std::shared_ptr<Reactions<NX, NV>> reactions;
     RelativeDynamics dyn;
+    // See NullCollisionConfig
+    CrossSectionTableConfig table = {};
+    bool parallel = false;
+    size_t n_energy_bins = 0;
+    size_t majorant_tile_size = 0;
+    std::optional<spatial::GridProp<NX>> source_grid = {};
 };
 
 template <unsigned NX, unsigned NV>
@@ -26,13 +32,91 @@ public:
     MCCReactionSet(particle::ChargedSpecies<NX, NV>* projectile, ReactionConfig<NX, NV>&& config);
     void react_all();
 
+    const CrossSectionTable& table() const { return sampler_.table(); }
+
+    // Event counters since the last reset, see MCCCounters
+    MCCCounters counters() const { return sampler_.counters(); }
+    void reset_counters() { sampler_.reset_counters(); }
+
 private:
     particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
     ReactionConfig<NX, NV> config_;
+    NullCollisionSampler<NX, NV> sampler_;
+};
+
+template <unsigned NX, unsigned NV>
+struct MixtureComponent {
+    std::shared_ptr<Target<NX, NV>> target;
+    std::shared_ptr<Reactions<NX, NV>> reactions;
+};
+
+template <unsigned NX, unsigned NV>
+struct MixtureReactionConfig {
+    double dt;
+    std::vector<MixtureComponent<NX, NV>> targets;
+    RelativeDynamics dyn;
+    // See NullCollisionConfig
+    CrossSectionTableConfig table = {};
+    bool parallel = false;
+    size_t n_energy_bins = 0;
+    size_t majorant_tile_size = 0;
+    std::optional<spatial::GridProp<NX>> source_grid = {};
+};
+
+// MCC reaction set of a projectile colliding with a gas mixture. A single null-collision sampling
+// is done against the sum of the collision frequencies of all targets, instead of one per target,
+// and the target is selected together with the reaction. The counters number the reactions over
+// all targets in order.
+template <unsigned NX, unsigned NV>
+class MCCMixtureReactionSet {
+public:
+    MCCMixtureReactionSet(particle::ChargedSpecies<NX, NV>* projectile,
+                          MixtureReactionConfig<NX, NV>&& config);
+    void react_all();
+
+    const CrossSectionTable& table() const { return sampler_.table(); }
+
+    MCCCounters counters() const { return sampler_.counters(); }
+    void reset_counters() { sampler_.reset_counters(); }
 
-    std::vector<size_t> particle_samples_;
-    std::unordered_set<size_t> used_cache_;
-    double max_sigma_v_ = 0.0;
+private:
+    particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
+    MixtureReactionConfig<NX, NV> config_;
+    std::vector<Reaction<NX, NV>*> reactions_;
+    NullCollisionSampler<NX, NV> sampler_;
+};
+
+template <unsigned NX, unsigned NV>
+struct EventReactionConfig {
+    double dt;
+    std::shared_ptr<Target<NX, NV>> target;
+    std::shared_ptr<Reactions<NX, NV>> reactions;
+    RelativeDynamics dyn;
+    // See EventCollisionConfig
+    CrossSectionTableConfig table = {};
+    size_t n_buckets = 1024;
+    double max_energy = 0.0;
+    std::optional<spatial::GridProp<NX>> source_grid = {};
+};
+
+// MCC reaction set using the event-driven EventCollisionSampler, for projectiles that collide
+// rarely compared to the time step
+template <unsigned NX, unsigned NV>
+class EventMCCReactionSet {
+public:
+    EventMCCReactionSet(particle::ChargedSpecies<NX, NV>* projectile,
+                        EventReactionConfig<NX, NV>&& config);
+    void react_all();
+
+    const CrossSectionTable& table() const { return sampler_.table(); }
+
+    MCCCounters counters() const { return sampler_.counters(); }
+    void reset_counters() { sampler_.reset_counters(); }
+
+private:
+    particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
+    EventReactionConfig<NX, NV> config_;
+    EventCollisionSampler<NX, NV> sampler_;
 };
 
-}  // namespace spark::collisions
\ No newline at end of file
+}  // namespace spark::collisions
@@ -0,0 +1,461 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "spark/collisions/cross_section_table.h"
+#include "spark/collisions/reaction.h"
+#include "spark/collisions/target.h"
+#include "spark/constants/constants.h"
+#include "spark/particle/cell_index.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+#include "spark/spatial/grid.h"
+
+namespace spark::collisions {
+
+enum class RelativeDynamics { SlowProjectile, FastProjectile };
+
+// A target gas and the cross sections of the reactions of the projectile with it
+template <unsigned NX, unsigned NV>
+struct NullCollisionTarget {
+    std::shared_ptr<Target<NX, NV>> target;
+    std::vector<const CrossSection*> cross_sections;
+};
+
+template <unsigned NX, unsigned NV>
+struct NullCollisionConfig {
+    double dt;
+    // Slow projectiles first select a target in proportion to its share of the majorant, then
+    // collide in the rest frame of a particle drawn at the temperature of that target
+    RelativeDynamics dyn;
+    CrossSectionTableConfig table = {};
+    // Processes the sampled particles in chunks on multiple threads. Reactions must then be safe to
+    // call concurrently for different projectiles.
+    bool parallel = false;
+    // Number of energy bins with individual majorant collision frequencies. With 0 or 1 a single
+    // majorant is used for all energies. Only supported for fast projectiles.
+    size_t n_energy_bins = 0;
+    // Side, in grid cells, of the tiles with individual majorant densities. With 0 the maximum
+    // density of the whole target is used. Requires a target with a density grid.
+    size_t majorant_tile_size = 0;
+    // Cells of the source map of the counters, which is not recorded when empty
+    std::optional<spatial::GridProp<NX>> source_grid = {};
+};
+
+// Event counters of a reaction set, only recorded when SPARK_ENABLE_MCC_COUNTERS is defined.
+// Energies are in eV, in the frame in which the reactions are applied.
+struct MCCCounters {
+    // Sampled collision candidates and those of them that did not collide
+    size_t candidates = 0;
+    size_t null_events = 0;
+    // Collisions of each reaction and the kinetic energy the projectile species lost in them,
+    // counting particles of the projectile species created by the reaction
+    std::vector<size_t> reactions;
+    std::vector<double> energy_lost;
+    // Particles of the projectile species created in each cell of the source grid
+    std::vector<double> source;
+
+    void clear() {
+        candidates = 0;
+        null_events = 0;
+        std::fill(reactions.begin(), reactions.end(), 0);
+        std::fill(energy_lost.begin(), energy_lost.end(), 0.0);
+        std::fill(source.begin(), source.end(), 0.0);
+    }
+
+    void merge(const MCCCounters& other) {
+        candidates += other.candidates;
+        null_events += other.null_events;
+        for (size_t r = 0; r < reactions.size(); ++r) {
+            reactions[r] += other.reactions[r];
+            energy_lost[r] += other.energy_lost[r];
+        }
+        for (size_t c = 0; c < source.size(); ++c)
+            source[c] += other.source[c];
+    }
+};
+
+// Cross sections of the reactions of a projectile with one or more targets in a single table. The
+// reactions of target t are the columns [offset(t), offset(t + 1)), and reactions are numbered
+// over all targets in order.
+template <unsigned NX, unsigned NV>
+class MixtureTable {
+public:
+    MixtureTable() = default;
+    MixtureTable(const std::vector<NullCollisionTarget<NX, NV>>& targets,
+                 double energy_scale,
+                 const CrossSectionTableConfig& config);
+
+    const CrossSectionTable& table() const { return table_; }
+    size_t n_targets() const { return targets_.size(); }
+    Target<NX, NV>& target(size_t t) const { return *targets_[t]; }
+    size_t offset(size_t t) const { return offsets_[t]; }
+
+    // Total cross section of target t at grid point i and at p
+    double total(size_t t, size_t i) const {
+        const double begin = t > 0 ? table_.cumulative(i, offsets_[t] - 1) : 0.0;
+        return table_.cumulative(i, offsets_[t + 1] - 1) - begin;
+    }
+
+    double total(size_t t, const CrossSectionTable::Point& p) const {
+        const double begin = t > 0 ? table_.cumulative(p, offsets_[t] - 1) : 0.0;
+        return table_.cumulative(p, offsets_[t + 1] - 1) - begin;
+    }
+
+    // Selects the reaction of a projectile at x for r1 in [0, 1) from the cumulative collision
+    // frequencies normalized by the majorant, given the speed over the majorant. Within the
+    // selected target, the reaction is the first whose cumulative cross section is not below the
+    // sampled one, or its last reaction if round-off leaves none. Returns n_reactions() of the
+    // table for a null collision.
+    size_t select(const core::Vec<NX>& x,
+                  const CrossSectionTable::Point& p,
+                  double r1,
+                  double v_over_nu) const;
+
+    // As select, among the reactions of target t only, given the speed over the majorant of t
+    size_t select_in(size_t t,
+                     const core::Vec<NX>& x,
+                     const CrossSectionTable::Point& p,
+                     double r1,
+                     double v_over_nu) const;
+
+private:
+    // First reaction of target t whose cumulative cross section is not below sigma, or its last
+    size_t reaction_of(size_t t, const CrossSectionTable::Point& p, double sigma) const {
+        const size_t last = offsets_[t + 1] - 1;
+        size_t r = offsets_[t];
+        while (r < last && sigma > table_.cumulative(p, r))
+            ++r;
+        return r;
+    }
+
+    std::vector<std::shared_ptr<Target<NX, NV>>> targets_;
+    std::vector<size_t> offsets_;
+    CrossSectionTable table_;
+};
+
+template <unsigned NX, unsigned NV>
+size_t MixtureTable<NX, NV>::select(const core::Vec<NX>& x,
+                                    const CrossSectionTable::Point& p,
+                                    const double r1,
+                                    const double v_over_nu) const {
+    // The frequency of a target is its density times the difference of the cumulative cross
+    // sections at the ends of its columns
+    double frequency = 0.0;
+    double cs_begin = 0.0;
+    for (size_t t = 0; t < targets_.size(); ++t) {
+        const double nu_factor = targets_[t]->dens_at(x) * v_over_nu;
+        const double cs_end = table_.cumulative(p, offsets_[t + 1] - 1);
+        const double target_frequency = nu_factor * (cs_end - cs_begin);
+
+        if (target_frequency > 0.0 && r1 <= frequency + target_frequency)
+            return reaction_of(t, p, cs_begin + (r1 - frequency) / nu_factor);
+
+        frequency += target_frequency;
+        cs_begin = cs_end;
+    }
+
+    return table_.n_reactions();
+}
+
+template <unsigned NX, unsigned NV>
+size_t MixtureTable<NX, NV>::select_in(const size_t t,
+                                       const core::Vec<NX>& x,
+                                       const CrossSectionTable::Point& p,
+                                       const double r1,
+                                       const double v_over_nu) const {
+    const double nu_factor = targets_[t]->dens_at(x) * v_over_nu;
+    const double cs_begin = t > 0 ? table_.cumulative(p, offsets_[t] - 1) : 0.0;
+    const double cs_end = table_.cumulative(p, offsets_[t + 1] - 1);
+
+    if (nu_factor > 0.0 && r1 <= nu_factor * (cs_end - cs_begin))
+        return reaction_of(t, p, cs_begin + r1 / nu_factor);
+
+    return table_.n_reactions();
+}
+
+// Records a collision of projectile id in the counters. The particles it created are those of
+// events in [first_created, end_created).
+template <unsigned NX, unsigned NV>
+void count_collision(const particle::ChargedSpecies<NX, NV>& projectile,
+                     const particle::CellIndex<NX, NV>* source_cells,
+                     size_t reaction,
+                     size_t id,
+                     double kinetic_energy,
+                     ReactionOutcome outcome,
+                     size_t first_created,
+                     size_t end_created,
+                     const ReactionEvents<NX, NV>& events,
+                     MCCCounters& counters) {
+    const auto energy = [&projectile](const core::Vec<NV>& v) {
+        return 0.5 * projectile.m() * (v.x * v.x + v.y * v.y + v.z * v.z) / constants::e;
+    };
+
+    const bool removed = static_cast<bool>(outcome & ReactionOutcome::ProjectileToBeRemoved);
+    double energy_out = removed ? 0.0 : energy(projectile.v()[id]);
+
+    for (size_t c = first_created; c < end_created; ++c) {
+        const auto& created = events.created[c];
+        if (created.species != &projectile)
+            continue;
+
+        energy_out += energy(created.v);
+        if (source_cells)
+            counters.source[source_cells->cell_of(created.x)] += 1.0;
+    }
+
+    counters.reactions[reaction]++;
+    counters.energy_lost[reaction] += kinetic_energy - energy_out;
+}
+
+// Work that waits for the scatterings queued in the events of a collision pass: the counting of
+// the collisions, which needs the velocities after them, and the return of slow projectiles from
+// the rest frame of their target particle
+template <unsigned NX, unsigned NV>
+struct DeferredCollisions {
+    struct Collision {
+        size_t reaction;
+        size_t id;
+        double kinetic_energy;
+        ReactionOutcome outcome;
+        size_t first_created;
+        size_t end_created;
+    };
+
+    std::vector<Collision> collisions;
+    std::vector<std::pair<size_t, core::Vec<3>>> frames;
+
+    void flush(particle::ChargedSpecies<NX, NV>& projectile,
+               const particle::CellIndex<NX, NV>* source_cells,
+               ReactionEvents<NX, NV>& events,
+               MCCCounters& counters) {
+        events.scattered.apply(projectile.v());
+
+        for (const auto& c : collisions)
+            count_collision(projectile, source_cells, c.reaction, c.id, c.kinetic_energy, c.outcome,
+                            c.first_created, c.end_created, events, counters);
+
+        for (const auto& [id, v_frame] : frames) {
+            auto& v = projectile.v()[id];
+            v.x += v_frame.x;
+            v.y += v_frame.y;
+            v.z += v_frame.z;
+        }
+
+        collisions.clear();
+        frames.clear();
+    }
+};
+
+// Null-collision Monte Carlo sampling of a projectile species against one or more targets.
+// Collision candidates are sampled once from the combined majorant collision frequency of all
+// targets, and target and reaction are selected from the tabulated cumulative collision
+// frequencies, leaving only the dispatch to the reaction itself to the reaction set.
+template <unsigned NX, unsigned NV>
+class NullCollisionSampler {
+public:
+    NullCollisionSampler() = default;
+    NullCollisionSampler(particle::ChargedSpecies<NX, NV>* projectile,
+                         const std::vector<NullCollisionTarget<NX, NV>>& targets,
+                         const NullCollisionConfig<NX, NV>& config);
+
+    // Samples the collision candidates and calls react(reaction, id, kinetic_energy, events) for
+    // those that collide, with the reaction selected by MixtureTable::select
+    template <typename React>
+    void react_all(React&& react);
+
+    const CrossSectionTable& table() const { return mixture_.table(); }
+    const NullCollisionConfig<NX, NV>& config() const { return config_; }
+
+    // Counters accumulated since the last reset, reduced over all chunks
+    MCCCounters counters() const;
+    void reset_counters();
+
+private:
+    template <typename React>
+    void react_range(size_t begin,
+                     size_t end,
+                     ReactionEvents<NX, NV>& events,
+                     DeferredCollisions<NX, NV>& deferred,
+                     MCCCounters& counters,
+                     React& react);
+    void sample();
+    void apply_events(size_t n_chunks);
+
+    void update_tile_majorants();
+    void update_tile_majorants(size_t target, double* tile_max);
+    size_t tile_of(const core::Vec<NX>& x) const;
+    void sample_bins();
+
+    double kinetic_energy(size_t idx) const {
+        const auto& v = projectile_->v()[idx];
+        return 0.5 * projectile_->m() * (v.x * v.x + v.y * v.y + v.z * v.z) / constants::e;
+    }
+
+    static constexpr size_t chunk_size_ = 1024;
+
+    particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
+    NullCollisionConfig<NX, NV> config_;
+
+    std::vector<size_t> particle_samples_;
+    std::vector<ReactionEvents<NX, NV>> events_;
+    std::vector<DeferredCollisions<NX, NV>> deferred_;
+    // Counters of each chunk, accumulated over steps and reduced on request
+    std::vector<MCCCounters> chunk_counters_;
+    std::optional<particle::CellIndex<NX, NV>> source_cells_;
+    // Random stream of each chunk
+    random::StreamPool streams_;
+
+    MixtureTable<NX, NV> mixture_;
+
+    // Particles are binned by energy and position tile, each bin with its own majorant. The bounds
+    // of sigma * v and of the density are stored per target, indexed [target][bin or tile].
+    size_t n_energy_bins_ = 1;
+    size_t n_tiles_ = 1;
+    size_t n_bins_ = 1;
+    std::vector<double> energy_bin_sigma_v_;
+    std::vector<double> tile_dens_max_;
+    std::vector<double> tile_max_energy_;
+    std::array<size_t, 3> n_cells_ = {1, 1, 1};
+    std::array<size_t, 3> n_tiles_dim_ = {1, 1, 1};
+    std::array<double, 3> inv_dx_ = {0.0, 0.0, 0.0};
+
+    std::vector<double> bin_nu_prime_;
+    // Share of each target in the majorant of each bin, [bin][target], for slow projectiles
+    std::vector<double> target_nu_prime_;
+    std::vector<uint32_t> particle_bin_;
+    std::vector<size_t> bin_offsets_;
+    std::vector<size_t> bin_particles_;
+    std::vector<size_t> bin_samples_;
+};
+
+template <unsigned NX, unsigned NV>
+template <typename React>
+void NullCollisionSampler<NX, NV>::react_all(React&& react) {
+    sample();
+
+    const size_t n_samples = particle_samples_.size();
+    const size_t n_chunks =
+        config_.parallel ? std::max<size_t>((n_samples + chunk_size_ - 1) / chunk_size_, 1) : 1;
+
+    if (events_.size() < n_chunks) {
+        events_.resize(n_chunks);
+        deferred_.resize(n_chunks);
+    }
+
+    if (chunk_counters_.size() < n_chunks) {
+        MCCCounters empty;
+        empty.reactions.assign(table().n_reactions(), 0);
+        empty.energy_lost.assign(table().n_reactions(), 0.0);
+        empty.source.assign(source_cells_ ? source_cells_->n_cells() : 0, 0.0);
+        chunk_counters_.resize(n_chunks, empty);
+    }
+
+    if (!config_.parallel) {
+        events_[0].clear();
+        react_range(0, n_samples, events_[0], deferred_[0], chunk_counters_[0], react);
+    } else {
+        // Each chunk draws from its own stream, so the outcome does not depend on the number of
+        // threads or on how chunks are scheduled
+        streams_.resize(n_chunks);
+        const auto n_chunks_signed = static_cast<long long>(n_chunks);
+
+#pragma omp parallel for schedule(dynamic)
+        for (long long c = 0; c < n_chunks_signed; ++c) {
+            const auto chunk = static_cast<size_t>(c);
+            random::ScopedStream stream(streams_[chunk]);
+
+            events_[chunk].clear();
+            react_range(chunk * chunk_size_, std::min((chunk + 1) * chunk_size_, n_samples),
+                        events_[chunk], deferred_[chunk], chunk_counters_[chunk], react);
+        }
+    }
+
+    apply_events(n_chunks);
+}
+
+template <unsigned NX, unsigned NV>
+template <typename React>
+void NullCollisionSampler<NX, NV>::react_range(const size_t begin,
+                                               const size_t end,
+                                               ReactionEvents<NX, NV>& events,
+                                               DeferredCollisions<NX, NV>& deferred,
+                                               MCCCounters& counters,
+                                               React& react) {
+    core::Vec<3> v_random;
+    const double m = projectile_->m();
+    const bool slow_projectile = config_.dyn == RelativeDynamics::SlowProjectile;
+
+    const size_t n_targets = mixture_.n_targets();
+
+    for (size_t s = begin; s < end; ++s) {
+        const size_t p_idx = particle_samples_[s];
+        const size_t bin = n_bins_ > 1 ? particle_bin_[p_idx] : 0;
+        double nu_prime = bin_nu_prime_[bin];
+
+        // The candidate goes to a target in proportion to its share of the majorant, which bounds
+        // the collision frequency with it in the rest frame of any of its particles
+        size_t target = 0;
+        if (slow_projectile) {
+            const double* shares = &target_nu_prime_[bin * n_targets];
+            double r0 = random::uniform() * nu_prime;
+            while (target + 1 < n_targets && r0 >= shares[target])
+                r0 -= shares[target++];
+            nu_prime = shares[target];
+
+            const double vth =
+                std::sqrt(constants::kb * mixture_.target(target).temperature() / m);
+
+            v_random = {random::normal() * vth, random::normal() * vth, random::normal() * vth};
+
+            auto& vp = projectile_->v()[p_idx];
+            vp.x -= v_random.x;
+            vp.y -= v_random.y;
+            vp.z -= v_random.z;
+        }
+
+        const double energy = kinetic_energy(p_idx);
+        const double r1 = random::uniform();
+
+        const double v_over_nu = std::sqrt(2.0 * constants::e * energy / m) / nu_prime;
+        const auto& x = projectile_->x()[p_idx];
+
+        const auto point = table().at(energy);
+        const size_t r = slow_projectile ? mixture_.select_in(target, x, point, r1, v_over_nu)
+                                         : mixture_.select(x, point, r1, v_over_nu);
+
+        auto outcome = ReactionOutcome::NotCollided;
+        if (r < table().n_reactions()) {
+            [[maybe_unused]] const size_t first_created = events.created.size();
+            outcome = react(r, p_idx, energy, events);
+            if (static_cast<bool>(outcome & ReactionOutcome::ProjectileToBeRemoved))
+                events.removed.push_back(p_idx);
+
+#ifdef SPARK_ENABLE_MCC_COUNTERS
+            if (static_cast<bool>(outcome & ReactionOutcome::Collided))
+                deferred.collisions.push_back(
+                    {r, p_idx, energy, outcome, first_created, events.created.size()});
+#endif
+        }
+
+#ifdef SPARK_ENABLE_MCC_COUNTERS
+        counters.candidates++;
+        if (!static_cast<bool>(outcome & ReactionOutcome::Collided))
+            counters.null_events++;
+#endif
+
+        if (slow_projectile)
+            deferred.frames.emplace_back(p_idx, v_random);
+    }
+
+    deferred.flush(*projectile_, source_cells_ ? &*source_cells_ : nullptr, events, counters);
+}
+
+}  // namespace spark::collisions
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
+#include "spark/collisions/scattering.h"
 #include "spark/core/enum_bit_ops.h"
 #include "spark/particle/species.h"
 
@@ -21,14 +24,51 @@ enum class ReactionOutcome : uint8_t {
 
 ENUM_CLASS_BIT_OPS(ReactionOutcome, uint8_t)
 
+// Changes to the particle populations recorded during a collision pass. They are applied after
+// the pass so that reactions can run concurrently on different projectiles. Deflections of the
+// projectile are applied in a batch before the creations and removals.
+template <unsigned NX, unsigned NV>
+struct ReactionEvents {
+    struct Creation {
+        particle::Species<NX, NV>* species = nullptr;
+        core::Vec<NX> x;
+        core::Vec<NV> v;
+    };
+
+    std::vector<Creation> created;
+    std::vector<size_t> removed;
+    scattering::ScatteringBatch scattered;
+
+    void create(particle::Species<NX, NV>& species, const core::Vec<NX>& x, const core::Vec<NV>& v) {
+        created.push_back({&species, x, v});
+    }
+
+    void scatter(size_t id, scattering::ScatteringKind kind, double v_mag, double param = 0.0) {
+        scattered.add(id, kind, v_mag, param);
+    }
+
+    void replace_velocity(size_t id, const core::Vec<NV>& v) { scattered.replace(id, v); }
+
+    void clear() {
+        created.clear();
+        removed.clear();
+        scattered.clear();
+    }
+};
+
 template <unsigned NX, unsigned NV>
 class Reaction {
 public:
     explicit Reaction(CrossSection&& cs) : m_cross_section(cs) {}
     CrossSection m_cross_section;
+
+    // Must only modify the projectile with index id; new particles are added through events.
+    // Deflections queued with events.scatter are applied after the pass, so the velocity of the
+    // projectile is not yet updated when react returns.
     virtual ReactionOutcome react(particle::ChargedSpecies<NX, NV>& projectile,
                                   size_t id,
-                                  double kinetic_energy) = 0;
+                                  double kinetic_energy,
+                                  ReactionEvents<NX, NV>& events) = 0;
     virtual ~Reaction() = default;
 };
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "spark/constants/constants.h"
 #include "spark/particle/species.h"
 
 namespace spark::collisions::scattering {
@@ -7,8 +12,120 @@ namespace spark::collisions::scattering {
 double random_chi();
 double random_chi2();
 
+// Cosine and sine of 2 pi u for u in [0, 1), from Taylor polynomials of a quarter of the angle
+// measured from pi and two angle doublings. Accurate to about 1e-15 and, unlike std::cos and
+// std::sin, vectorizable.
+inline void sincos_2pi(const double u, double& cos_phi, double& sin_phi) {
+    // q in [-pi/4, pi/4), where the series up to q^16 and q^17 are exact to below 1e-16
+    const double q = 0.5 * constants::pi * u - 0.25 * constants::pi;
+    const double q2 = q * q;
+
+    double s = 0.0;
+    double c = 0.0;
+    for (int k = 9; k >= 1; --k) {
+        s = 1.0 - s * q2 * (1.0 / ((2.0 * k) * (2.0 * k + 1.0)));
+        c = 1.0 - c * q2 * (1.0 / ((2.0 * k - 1.0) * (2.0 * k)));
+    }
+    s *= q;
+
+    // 2 pi u = 4 q + pi
+    const double s2 = 2.0 * s * c;
+    const double c2 = (c - s) * (c + s);
+    cos_phi = (s2 - c2) * (s2 + c2);
+    sin_phi = -2.0 * s2 * c2;
+}
+
+// Uniformly distributed unit vector
+spark::core::Vec<3> isotropic_direction();
+
+// Change of u when it is deflected by the polar angle chi and the azimuthal angle phi with respect
+// to its own direction (T. Takizuka and H. Abe, J. Comput. Phys. 25, 205 (1977)). 1 - cos(chi) is
+// passed directly to keep small deflections accurate. Inline so that loops over many vectors can
+// be vectorized.
+inline spark::core::Vec<3> rotation_delta(const spark::core::Vec<3>& u,
+                                          const double one_minus_cos_chi,
+                                          const double sin_chi,
+                                          const double cos_phi,
+                                          const double sin_phi) {
+    const double u_perp = std::sqrt(u.x * u.x + u.y * u.y);
+    const double u_mag = std::sqrt(u_perp * u_perp + u.z * u.z);
+
+    // Along z the azimuth can be measured from the x axis
+    const bool along_z = u_perp <= 1e-12 * u_mag;
+    const double cx = along_z ? 1.0 : u.x / u_perp;
+    const double cy = along_z ? 0.0 : u.y / u_perp;
+    const double a = u.z * sin_chi * cos_phi;
+    const double b = u_mag * sin_chi * sin_phi;
+
+    return {cx * a - cy * b - u.x * one_minus_cos_chi, cy * a + cx * b - u.y * one_minus_cos_chi,
+            -u_perp * sin_chi * cos_phi - u.z * one_minus_cos_chi};
+}
+
 spark::core::Vec<3> isotropic_scatter(const spark::core::Vec<3>& v, double chi);
 
+// Distribution of the deflection angle chi and the speed after it
+enum class ScatteringKind : uint8_t {
+    // Isotropic chi and the given speed
+    Isotropic,
+    // Isotropic chi and the given speed times sqrt(1 - param * (1 - cos chi)), the elastic
+    // energy loss on a heavy target with param = 2 m / M
+    IsotropicElastic,
+    // cos chi = sqrt(1 - U), as random_chi2, and the given speed times cos chi, the elastic
+    // collision with a target of equal mass at rest
+    EqualMassElastic,
+    // cos chi given as the parameter, for angles sampled by the reaction, and the given speed
+    GivenAngle,
+};
+
+// Deflections of the particles of one species queued during a collision pass and applied
+// together. The deflection angles are sampled directly as cos chi, without acos, and the
+// rotations of a block of particles are computed in a single vectorized loop. Velocities can
+// also be replaced outright, e.g. by charge exchange.
+class ScatteringBatch {
+public:
+    void add(size_t id, ScatteringKind kind, double v_mag, double param = 0.0) {
+        ids_.push_back(id);
+        kinds_.push_back(kind);
+        v_mag_.push_back(v_mag);
+        param_.push_back(param);
+    }
+
+    void replace(size_t id, const spark::core::Vec<3>& v) { replaced_.push_back({id, v}); }
+
+    // Deflects the queued particles of the velocity array v, then sets the replaced velocities,
+    // and clears the batch. The speeds refer to the frame of the velocities at the time of the
+    // call.
+    void apply(spark::core::Vec<3>* v);
+
+    size_t size() const { return ids_.size() + replaced_.size(); }
+    bool empty() const { return ids_.empty() && replaced_.empty(); }
+
+    void clear() {
+        ids_.clear();
+        kinds_.clear();
+        v_mag_.clear();
+        param_.clear();
+        replaced_.clear();
+    }
+
+private:
+    struct Replacement {
+        size_t id;
+        spark::core::Vec<3> v;
+    };
+
+    static constexpr size_t block_size_ = 256;
+
+    std::vector<Replacement> replaced_;
+    std::vector<size_t> ids_;
+    std::vector<ScatteringKind> kinds_;
+    std::vector<double> v_mag_;
+    std::vector<double> param_;
+
+    std::vector<double> uniforms_;
+    std::vector<spark::core::Vec<3>> v_block_;
+};
+
 template <unsigned NX>
 void isotropic_coll(particle::ChargedSpecies<NX, 3>& species, size_t idx, double vmag, double chi);
 
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "spark/collisions/null_collision.h"
+#include "spark/collisions/reaction.h"
+#include "spark/particle/species.h"
+
+namespace spark::collisions {
+
+// MCC reaction set with the reactions fixed at compile time. The reactions are stored by value in
+// a tuple and the dispatch is unrolled with a fold expression, so each react call is made on the
+// concrete (final) type and can be inlined. The cross sections of all reactions are kept in the
+// single table of the sampler.
+//
+//     using Elastic = ElectronElasticCollision<1, 3>;
+//     using Ionization = IonizationCollision<1, 3>;
+//     StaticMCCReactionSet<1, 3, Elastic, Ionization> set(&electrons, target, config,
+//                                                         Elastic(...), Ionization(...));
+template <unsigned NX, unsigned NV, typename... Rs>
+class StaticMCCReactionSet {
+    static_assert(sizeof...(Rs) > 0, "a reaction set needs at least one reaction");
+
+public:
+    StaticMCCReactionSet(particle::ChargedSpecies<NX, NV>* projectile,
+                         std::shared_ptr<Target<NX, NV>> target,
+                         const NullCollisionConfig<NX, NV>& config,
+                         Rs&&... reactions)
+        : projectile_(projectile), reactions_(std::move(reactions)...) {
+        auto cross_sections = std::apply(
+            [](const auto&... r) {
+                return std::vector<const CrossSection*>{&r.m_cross_section...};
+            },
+            reactions_);
+
+        sampler_ = NullCollisionSampler<NX, NV>(
+            projectile_, {{std::move(target), std::move(cross_sections)}}, config);
+    }
+
+    void react_all() {
+        sampler_.react_all([this](size_t reaction, size_t id, double kinetic_energy,
+                                  ReactionEvents<NX, NV>& events) {
+            return dispatch(reaction, id, kinetic_energy, events, std::index_sequence_for<Rs...>{});
+        });
+    }
+
+    template <size_t I>
+    auto& reaction() {
+        return std::get<I>(reactions_);
+    }
+
+    const CrossSectionTable& table() const { return sampler_.table(); }
+
+    MCCCounters counters() const { return sampler_.counters(); }
+    void reset_counters() { sampler_.reset_counters(); }
+
+private:
+    template <size_t... Is>
+    ReactionOutcome dispatch(size_t reaction,
+                             size_t id,
+                             double kinetic_energy,
+                             ReactionEvents<NX, NV>& events,
+                             std::index_sequence<Is...>) {
+        ReactionOutcome outcome = ReactionOutcome::NotCollided;
+        (void)((Is == reaction &&
+                (outcome = std::get<Is>(reactions_).react(*projectile_, id, kinetic_energy, events),
+                 true)) ||
+               ...);
+        return outcome;
+    }
+
+    particle::ChargedSpecies<NX, NV>* projectile_ = nullptr;
+    std::tuple<Rs...> reactions_;
+    NullCollisionSampler<NX, NV> sampler_;
+};
+
+}  // namespace spark::collisions
@@ -15,6 +15,12 @@ public:
     virtual double dens_at(const core::Vec<NX>& pos) = 0;
     virtual double dens_max() = 0;
     virtual double temperature() = 0;
+
+    // Node values the density is interpolated from, used to build spatially local majorants
+    virtual const spatial::UniformGrid<NX>* density_grid() { return nullptr; }
+    // Whether the density can change between collision steps
+    virtual bool varying() { return false; }
+
     virtual ~Target() = default;
 };
 
@@ -46,6 +52,7 @@ public:
     }
     double dens_max() override { return field_max_; }
     double temperature() override { return temperature_; }
+    const spatial::UniformGrid<NX>* density_grid() override { return &field_; }
 
 private:
     double temperature_ = 0.0;
@@ -64,9 +71,11 @@ public:
     }
     double dens_max() override {
         auto& data = density_->data().data();
-        return *std::max_element(data.begin(), data.begin());
+        return *std::max_element(data.begin(), data.end());
     }
     double temperature() override { return temperature_; }
+    const spatial::UniformGrid<NX>* density_grid() override { return density_; }
+    bool varying() override { return true; }
 
 private:
     double temperature_ = 0.0;
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <type_traits>
+#include <vector>
 
+#include "spark/constants/constants.h"
 #include "spark/core/matrix.h"
 #include "spark/core/vec.h"
 #include "spark/particle/species.h"
+#include "spark/random/random.h"
 #include "spark/spatial/grid.h"
 
 namespace spark::particle {
@@ -15,11 +24,83 @@ void apply_symmetric_boundary(ChargedSpecies<1, NV>& species, double xmin, doubl
 template <unsigned NV>
 void apply_absorbing_boundary(ChargedSpecies<1, NV>& species, double xmin, double xmax);
 
-enum class BoundaryType { Specular, Absorbing };
+// Diffuse re-emits the particles with their speed in a direction drawn from the cosine law around
+// the normal of the wall. Thermal re-emits a fraction of them, the accommodation coefficient, with
+// the velocity of a Maxwellian flux at the temperature of the wall, and reflects the others
+// specularly (Maxwell's model of the wall).
+enum class BoundaryType { Specular, Absorbing, Diffuse, Thermal };
 
 struct TiledBoundary {
     core::IntVec<2> lower_left, upper_right;
     BoundaryType boundary_type = BoundaryType::Absorbing;
+    // Temperature [eV] and accommodation coefficient of Thermal boundaries
+    double temperature = 0.0;
+    double accommodation = 1.0;
+};
+
+// Face of a tile cell exposed to an empty cell of the domain, in physical units
+struct BoundaryFace {
+    // Start of the face and vector along it, whose length is the area of the face per unit depth
+    core::Vec<2> origin;
+    core::Vec<2> tangent;
+    // Outward unit normal, pointing into the empty cell
+    core::Vec<2> normal;
+    // Index of the tile in TiledBoundary2D::boundaries()
+    int boundary = 0;
+};
+
+namespace detail {
+struct CollisionHit;
+}
+
+struct WallCountersConfig {
+    // Also count per exposed face, in the order of TiledBoundary2D::counted_faces(). Each chunk of
+    // particles of the parallel mode holds its own face counters.
+    bool per_face = false;
+    // Histograms per boundary of the impact angle to the normal of the face, over [0, pi/2], and
+    // of the kinetic energy [eV], over [0, max_energy), higher energies falling in the last bin.
+    // Not recorded when the number of bins is 0.
+    size_t n_angle_bins = 0;
+    size_t n_energy_bins = 0;
+    double max_energy = 0.0;
+};
+
+// Hits of the particles on the tiles and their kinetic energy [eV] at impact, summed over the
+// applications of the boundaries since the last reset
+struct WallCounters {
+    // Per boundary, in the order of TiledBoundary2D::boundaries()
+    std::vector<size_t> hits;
+    std::vector<double> energy;
+    // Per exposed face, when enabled
+    std::vector<size_t> face_hits;
+    std::vector<double> face_energy;
+    // Histograms by boundary then bin, e.g. angle_histogram[b * n_angle_bins + k]
+    std::vector<size_t> angle_histogram;
+    std::vector<size_t> energy_histogram;
+
+    void clear() {
+        std::fill(hits.begin(), hits.end(), 0);
+        std::fill(energy.begin(), energy.end(), 0.0);
+        std::fill(face_hits.begin(), face_hits.end(), 0);
+        std::fill(face_energy.begin(), face_energy.end(), 0.0);
+        std::fill(angle_histogram.begin(), angle_histogram.end(), 0);
+        std::fill(energy_histogram.begin(), energy_histogram.end(), 0);
+    }
+
+    void merge(const WallCounters& other) {
+        for (size_t b = 0; b < hits.size(); ++b) {
+            hits[b] += other.hits[b];
+            energy[b] += other.energy[b];
+        }
+        for (size_t f = 0; f < face_hits.size(); ++f) {
+            face_hits[f] += other.face_hits[f];
+            face_energy[f] += other.face_energy[f];
+        }
+        for (size_t k = 0; k < angle_histogram.size(); ++k)
+            angle_histogram[k] += other.angle_histogram[k];
+        for (size_t k = 0; k < energy_histogram.size(); ++k)
+            energy_histogram[k] += other.energy_histogram[k];
+    }
 };
 
 class TiledBoundary2D {
@@ -28,30 +109,408 @@ public:
     TiledBoundary2D(const spatial::GridProp<2>& grid_prop,
                     const std::vector<TiledBoundary>& boundaries,
                     double dt,
-                    bool empty_box = false);
+                    bool empty_box = false,
+                    bool parallel = false);
 
-    // TODO(lui): remove the dependency on std::function by using templates and lambdas. However
-    // this means that we need to move all the code to the header.
     using Callback = std::function<void(int, core::Vec<2>, core::Vec<3>)>;
 
-    void apply(Species<2, 3>& species, const Callback& collision_callback = nullptr);
+    // Applies the boundaries to the particles that moved in the last step, calling
+    // on_hit(boundary, x, v) for each hit of a tile, before its effect on the particle. The
+    // callback is inlined into the raycast loop, and the overload without callback compiles out
+    // everything related to it. The std::function overload type-erases the callback.
+    //
+    // In parallel mode the particles are processed in chunks on multiple threads, which record
+    // their hits and removals. The hits are then passed to the callback in the order of the
+    // particles and the removals applied at once, so the callback is called from the calling
+    // thread but after the whole species was processed.
+    template <typename F>
+        requires(!std::same_as<std::remove_cvref_t<F>, Callback> &&
+                 !std::same_as<std::remove_cvref_t<F>, std::nullptr_t>)
+    void apply(Species<2, 3>& species, F&& on_hit) {
+        apply_impl(species, on_hit);
+    }
+
+    void apply(Species<2, 3>& species);
+    void apply(Species<2, 3>& species, const Callback& collision_callback);
+
+    // Moves a particle of mass m from x0 to x1 = x0 + v * duration through the tiles, handling
+    // its hits as apply() does, e.g. for particles injected during the step. Returns whether the
+    // particle is to be removed. The hits are counted in the counters of the first chunk, so it
+    // must not be called concurrently.
+    template <typename F>
+    bool move(const core::Vec<2>& x0,
+              core::Vec<2>& x1,
+              core::Vec<3>& v,
+              double duration,
+              double m,
+              F&& on_hit) {
+        auto* counters = counters_enabled_ ? &chunk_counters_[0] : nullptr;
+        return trace(x0, x1, v, duration, on_hit, counters, m);
+    }
+
+    bool move(const core::Vec<2>& x0,
+              core::Vec<2>& x1,
+              core::Vec<3>& v,
+              double duration,
+              double m) {
+        return move(x0, x1, v, duration, m, NoCallback{});
+    }
+
     uint8_t cell(int i, int j) const;
     uint8_t cell(const core::Vec<2>& pos) const;
 
     const std::vector<TiledBoundary>& boundaries() const { return boundaries_; }
 
+    // Faces of the cells of tile `boundary` (index in boundaries()) that border an empty cell of
+    // the domain, e.g. to inject particles from the walls. Faces shared with other tiles or on the
+    // edge of the domain are not exposed.
+    std::vector<BoundaryFace> exposed_faces(int boundary) const;
+
+    // Records the hits of the following applications in the counters, thread-locally in parallel
+    // mode. Calling it again resets them.
+    void enable_counters(const WallCountersConfig& config);
+    bool counters_enabled() const { return counters_enabled_; }
+    const WallCountersConfig& counters_config() const { return counters_config_; }
+
+    // Counters accumulated since the last reset, reduced over all chunks in a fixed order
+    WallCounters counters() const;
+    void reset_counters();
+
+    // Faces of the face counters: the exposed faces of all boundaries, by boundary
+    const std::vector<BoundaryFace>& counted_faces() const { return counted_faces_; }
+
 private:
+    struct Hit {
+        int boundary;
+        core::Vec<2> x;
+        core::Vec<3> v;
+    };
+
+    // Hits and removals of a chunk of particles in parallel mode
+    struct ChunkEvents {
+        std::vector<Hit> hits;
+        std::vector<size_t> removed;
+    };
+
+    // Callback of apply() without callback
+    struct NoCallback {
+        void operator()(int, const core::Vec<2>&, const core::Vec<3>&) const {}
+    };
+
+    template <typename F>
+    void apply_impl(Species<2, 3>& species, F& on_hit);
+    template <typename F>
+    void apply_parallel(Species<2, 3>& species, F& on_hit);
+
+    // Moves a particle through its collisions with the tiles in the last step, calling on_hit
+    // for each and recording it in the counters if not null, and returns whether it is to be
+    // removed
+    template <typename F>
+    bool collide(core::Vec<2>& x1,
+                 core::Vec<3>& v1,
+                 F& on_hit,
+                 WallCounters* counters,
+                 double m) const;
+
+    // As collide, for a particle that moved from x0 to x1 in the given time
+    template <typename F>
+    bool trace(const core::Vec<2>& x0,
+               core::Vec<2>& x1,
+               core::Vec<3>& v1,
+               double duration,
+               F& on_hit,
+               WallCounters* counters,
+               double m) const;
+
+    void record(WallCounters& counters,
+                const detail::CollisionHit& hit,
+                const core::Vec<3>& v,
+                double m) const;
+    WallCounters empty_counters() const;
+
+    // Walks the cells crossed by the segment from a to b, in cell units, and sets hit to the first
+    // tile cell, if any. Empty blocks of cells around the ray are crossed at once, so that long
+    // rays through empty regions cost little more than short ones.
+    void raycast(const core::Vec<2>& a, const core::Vec<2>& b, detail::CollisionHit& hit) const;
+
     void add_boundary(const TiledBoundary& boundary, uint8_t id);
+    // Manhattan distance in cells from each cell to the closest tile, saturated at the maximum of
+    // the type, which only makes the early exit of apply() more conservative
+    using Distance = uint16_t;
+
     void set_distance_cells();
-    int bfs_closest_boundary(int i, int j);
+    void set_occupancy();
     int sx_ = 0, sy_ = 0;
 
-    core::TMatrix<uint8_t, 2> distance_cells_;
+    // Occupancy of the square blocks of cells_ of each size in block_sizes_, mip-map style:
+    // non-zero when any cell of the block is a tile. The blocks on the upper edges may be partial.
+    static constexpr int block_sizes_[2] = {4, 16};
+    core::TMatrix<uint8_t, 2> occupancy_[2];
+
+    core::TMatrix<Distance, 2> distance_cells_;
     core::TMatrix<uint8_t, 2> cells_;
     spatial::GridProp<2> gprop_;
     std::vector<TiledBoundary> boundaries_;
     double dt_ = 0.0;
     bool empty_box_ = false;
+
+    static constexpr size_t chunk_size_ = 4096;
+    bool parallel_ = false;
+    std::vector<ChunkEvents> events_;
+    // Random stream of each chunk, when Diffuse or Thermal boundaries draw random numbers
+    bool random_reflections_ = false;
+    random::StreamPool streams_;
+
+    bool counters_enabled_ = false;
+    WallCountersConfig counters_config_;
+    // Counters of each chunk, accumulated over applications and reduced on request
+    std::vector<WallCounters> chunk_counters_;
+    std::vector<BoundaryFace> counted_faces_;
+    // Sorted keys of the counted faces (see face_key), and the index of each face
+    std::vector<uint64_t> face_keys_;
+    std::vector<uint32_t> face_ids_;
+};
+
+namespace detail {
+
+struct CollisionHit {
+    core::Vec<2> normal;
+    core::Vec<2> pos;
+    uint8_t val = 0;
+    // Cell of the tile that was hit
+    int cell_x = 0, cell_y = 0;
 };
 
+inline int cmod(int idx, int size) {
+    return ((size + (idx % size)) % size);
+}
+
+inline int floor_index(double fp) {
+    int x = int(fp);
+    if (x > fp)
+        x--;
+    return x;
+}
+
+inline core::Vec<2> reflect(const core::Vec<2>& x,
+                            const core::Vec<2>& n,
+                            const core::Vec<2>& contact) {
+    // Omitting terms:
+    // 1) 2 * n.x * n.y * (contact.y - x.y) in x
+    // 2) 2 * n.x * n.y * (contact.x - x.x) in y
+    // Since they will always be zero if n is axis aligned
+    return {2.0 * (contact.x - x.x) * n.x * n.x + x.x, 2.0 * (contact.y - x.y) * n.y * n.y + x.y};
+}
+
+inline core::Vec<3> reflect(const core::Vec<3>& v, const core::Vec<2>& n) {
+    return {v.x * (1.0 - 2.0 * n.x * n.x), v.y * (1.0 - 2.0 * n.y * n.y), v.z};
+}
+
+// Velocity of a particle of the given speed leaving a wall of outward normal n in a direction
+// drawn from the cosine law. By Malley's method, the tangential components are those of a point
+// drawn uniformly in the unit disk, which needs neither trigonometric functions nor a square root
+// of a logarithm.
+inline core::Vec<3> diffuse_velocity(const core::Vec<2>& n, const double speed) {
+    double a, b, r2;
+    do {
+        a = 2.0 * random::uniform() - 1.0;
+        b = 2.0 * random::uniform() - 1.0;
+        r2 = a * a + b * b;
+    } while (r2 >= 1.0);
+
+    const double vn = speed * std::sqrt(1.0 - r2);
+    const double vt = speed * a;
+    return {n.x * vn - n.y * vt, n.y * vn + n.x * vt, speed * b};
+}
+
+// Velocity of a particle of a Maxwellian flux of thermal speed vth leaving a wall of outward
+// normal n
+inline core::Vec<3> thermal_velocity(const core::Vec<2>& n, const double vth) {
+    const double vn = vth * std::sqrt(-2.0 * std::log(1.0 - random::uniform()));
+    const double vt = vth * random::normal();
+    return {n.x * vn - n.y * vt, n.y * vn + n.x * vt, vth * random::normal()};
+}
+
+// Particles found inside a tile are removed to avoid errors
+inline constexpr bool remove_inside_tiles = true;
+
+}  // namespace detail
+
+template <typename F>
+void TiledBoundary2D::apply_impl(Species<2, 3>& species, F& on_hit) {
+    if (parallel_) {
+        apply_parallel(species, on_hit);
+        return;
+    }
+
+    int n = species.n();
+    auto* x = species.x();
+    auto* v = species.v();
+    auto* counters = counters_enabled_ ? &chunk_counters_[0] : nullptr;
+    const double m = species.m();
+
+    for (int i = 0; i < n; ++i) {
+        if (collide(x[i], v[i], on_hit, counters, m)) {
+            species.remove(i);
+            i--;  // check ith particle again since the particle is replaced during removal
+            n--;  // decrease the number of particles
+        }
+    }
+}
+
+template <typename F>
+void TiledBoundary2D::apply_parallel(Species<2, 3>& species, F& on_hit) {
+    constexpr bool record_hits = !std::is_same_v<std::remove_cv_t<F>, NoCallback>;
+    const size_t n = species.n();
+    auto* x = species.x();
+    auto* v = species.v();
+
+    const size_t n_chunks = std::max<size_t>((n + chunk_size_ - 1) / chunk_size_, 1);
+    if (events_.size() < n_chunks)
+        events_.resize(n_chunks);
+    if (counters_enabled_ && chunk_counters_.size() < n_chunks)
+        chunk_counters_.resize(n_chunks, empty_counters());
+    if (random_reflections_)
+        streams_.resize(n_chunks);
+    const double m = species.m();
+
+    const auto n_chunks_signed = static_cast<long long>(n_chunks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (long long c = 0; c < n_chunks_signed; ++c) {
+        const auto chunk = static_cast<size_t>(c);
+        auto& events = events_[chunk];
+        events.hits.clear();
+        events.removed.clear();
+        auto* counters = counters_enabled_ ? &chunk_counters_[chunk] : nullptr;
+
+        auto record_hit = [&events](int boundary, const core::Vec<2>& pos,
+                                    const core::Vec<3>& vel) {
+            if constexpr (record_hits)
+                events.hits.push_back({boundary, pos, vel});
+        };
+
+        const auto process = [&] {
+            const size_t end = std::min((chunk + 1) * chunk_size_, n);
+            for (size_t i = chunk * chunk_size_; i < end; ++i) {
+                if (collide(x[i], v[i], record_hit, counters, m))
+                    events.removed.push_back(i);
+            }
+        };
+
+        // Each chunk draws from its own stream, so the outcome does not depend on the number of
+        // threads or on how chunks are scheduled
+        if (random_reflections_) {
+            random::ScopedStream stream(streams_[chunk]);
+            process();
+        } else {
+            process();
+        }
+    }
+
+    // Hits in the order of the particles, whatever the scheduling of the chunks
+    if constexpr (record_hits) {
+        for (size_t c = 0; c < n_chunks; ++c)
+            for (const auto& hit : events_[c].hits)
+                on_hit(hit.boundary, hit.x, hit.v);
+    }
+
+    // Chunks cover increasing ranges, so the removals are merged in ascending order. They are
+    // applied in descending order so that the swap with the last particle never moves another
+    // particle that is also marked for removal.
+    for (size_t c = n_chunks; c-- > 0;) {
+        const auto& removed = events_[c].removed;
+        for (auto it = removed.rbegin(); it != removed.rend(); ++it)
+            species.remove(*it);
+    }
+}
+
+template <typename F>
+bool TiledBoundary2D::collide(core::Vec<2>& x1,
+                              core::Vec<3>& v1,
+                              F& on_hit,
+                              WallCounters* counters,
+                              const double m) const {
+    if (empty_box_ && (x1.x > 0 && x1.x < gprop_.l.x && x1.y > 0 && x1.y < gprop_.l.y))
+        return false;
+
+    const auto x0 = core::Vec<2>{x1.x - v1.x * dt_, x1.y - v1.y * dt_};
+    return trace(x0, x1, v1, dt_, on_hit, counters, m);
+}
+
+template <typename F>
+bool TiledBoundary2D::trace(const core::Vec<2>& x0,
+                            core::Vec<2>& x1,
+                            core::Vec<3>& v1,
+                            const double duration,
+                            F& on_hit,
+                            WallCounters* counters,
+                            const double m) const {
+    auto x0_tmp = x0 / gprop_.dx;
+    auto x1_tmp = x1 / gprop_.dx;
+
+    const auto x0_cell = x0_tmp.apply<std::floor>().to<int>();
+    const auto x1_cell = x1_tmp.apply<std::floor>().to<int>();
+
+    const Distance distance_to_boundary = distance_cells_(x0_cell.x, x0_cell.y);
+    if (std::abs(x0_cell.x - x1_cell.x) + std::abs(x0_cell.y - x1_cell.y) < distance_to_boundary)
+        return false;
+
+    // If particle is inside wall, remove it to avoid errors
+    if (detail::remove_inside_tiles && distance_to_boundary == 0)
+        return true;
+
+    detail::CollisionHit hit{};
+    // Time left in the step at x0, as diffuse reflections continue the rest of it with a new
+    // velocity
+    double time_left = duration;
+
+    while (true) {
+        raycast(x0_tmp, x1_tmp, hit);
+
+        // val == 0 means that no boundary was found
+        if (!hit.val)
+            break;
+
+        const auto& b = boundaries_[hit.val - 1];
+        auto btype = b.boundary_type;
+
+        on_hit(hit.val - 1, x1, v1);
+        if (counters)
+            record(*counters, hit, v1, m);
+
+        if (btype == BoundaryType::Absorbing) {
+            // TODO(lui): Check if this is OK
+            return true;
+        }
+
+        const double path = (x1_tmp - x0_tmp).norm();
+        if (path > 0.0)
+            time_left *= 1.0 - (hit.pos - x0_tmp).norm() / path;
+
+        if (btype == BoundaryType::Thermal && random::uniform() >= b.accommodation)
+            btype = BoundaryType::Specular;
+
+        if (btype == BoundaryType::Specular) {
+            // Specular reflection
+            x1 = detail::reflect(x1, hit.normal, hit.pos * gprop_.dx);
+            v1 = detail::reflect(v1, hit.normal);
+        } else {
+            if (btype == BoundaryType::Diffuse) {
+                v1 = detail::diffuse_velocity(hit.normal, v1.norm());
+            } else {
+                const double vth = std::sqrt(constants::e * b.temperature / m);
+                v1 = detail::thermal_velocity(hit.normal, vth);
+            }
+            const auto contact = hit.pos * gprop_.dx;
+            x1 = {contact.x + v1.x * time_left, contact.y + v1.y * time_left};
+        }
+
+        x1_tmp = x1 / gprop_.dx;
+        x0_tmp = hit.pos;
+    }
+
+    return false;
+}
+
 }  // namespace spark::particle
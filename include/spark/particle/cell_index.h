@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <vector>
+
+#include "spark/core/vec.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+#include "spark/spatial/grid.h"
+
+namespace spark::particle {
+
+// Particles of a species grouped by the grid cell that contains them. The index is built with a
+// counting sort, so the particles of each cell are contiguous in the index and in increasing order.
+template <unsigned NX, unsigned NV>
+class CellIndex {
+public:
+    CellIndex() = default;
+
+    // The cells are the ones between the nodes of a grid with the given properties
+    explicit CellIndex(const spatial::GridProp<NX>& grid);
+
+    // Rebuilds the index for the current positions of the particles
+    void update(const Species<NX, NV>& species);
+
+    // Reorders the particles of the species by cell and rebuilds the index. Afterwards the
+    // particles of each cell are also contiguous in the species itself.
+    void sort(Species<NX, NV>& species);
+
+    size_t cell_of(const core::Vec<NX>& x) const;
+
+    size_t n_cells() const { return n_cells_total_; }
+    size_t count(size_t cell) const { return offsets_[cell + 1] - offsets_[cell]; }
+    std::span<const size_t> particles(size_t cell) const {
+        return {particles_.data() + offsets_[cell], count(cell)};
+    }
+
+    // Product of the cell sizes in the NX resolved dimensions
+    double cell_volume() const { return cell_volume_; }
+
+    // Consecutive cells processed together by for_each_cell_chunk
+    static constexpr size_t cells_per_chunk = 64;
+    size_t n_chunks() const { return (n_cells_total_ + cells_per_chunk - 1) / cells_per_chunk; }
+
+private:
+    std::array<size_t, NX> n_cells_{};
+    std::array<double, NX> inv_dx_{};
+    size_t n_cells_total_ = 0;
+    double cell_volume_ = 0.0;
+
+    std::vector<size_t> cells_;
+    std::vector<size_t> offsets_;
+    std::vector<size_t> particles_;
+
+    std::vector<core::Vec<NX>> x_buffer_;
+    std::vector<core::Vec<NV>> v_buffer_;
+    std::vector<double> t_buffer_;
+};
+
+// Calls f(chunk, begin, end) for the chunks of cells [begin, end) of the index, on multiple threads
+// when parallel, or once for all the cells as chunk 0 otherwise. Each chunk draws from its own
+// stream of the pool, so the outcome does not depend on the number of threads or on how the
+// chunks are scheduled.
+template <unsigned NX, unsigned NV, typename F>
+void for_each_cell_chunk(const CellIndex<NX, NV>& index,
+                         random::StreamPool& streams,
+                         const bool parallel,
+                         F&& f) {
+    const size_t n_cells = index.n_cells();
+    if (!parallel) {
+        f(size_t{0}, size_t{0}, n_cells);
+        return;
+    }
+
+    constexpr size_t chunk_size = CellIndex<NX, NV>::cells_per_chunk;
+    const size_t n_chunks = index.n_chunks();
+    streams.resize(n_chunks);
+
+    const auto n_chunks_signed = static_cast<long long>(n_chunks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (long long c = 0; c < n_chunks_signed; ++c) {
+        const auto chunk = static_cast<size_t>(c);
+        random::ScopedStream stream(streams[chunk]);
+        f(chunk, chunk * chunk_size, std::min((chunk + 1) * chunk_size, n_cells));
+    }
+}
+
+}  // namespace spark::particle
@@ -1,30 +1,193 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <concepts>
 #include <memory>
+#include <span>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "spark/constants/constants.h"
+#include "spark/random/alias_table.h"
 #include "spark/random/random.h"
+#include "spark/spatial/grid.h"
 #include "species.h"
 
 namespace spark::particle {
 
+// Distributions of a single component. Calling one draws a sample, and sample(values) fills a
+// batch with the bulk generators and a vectorized transform, which the emitters use when a
+// distribution provides it. Plain lambdas remain valid distributions and are called per sample.
 namespace distributions {
+
+struct Maxwell {
+    double vth;
+    double drift;
+
+    double operator()() const { return spark::random::normal(drift, vth); }
+
+    void sample(std::span<double> values) const {
+        spark::random::fill_normal(values);
+        const size_t n = values.size();
+        double* out = values.data();
+#pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+            out[i] = drift + vth * out[i];
+    }
+};
+
+struct Uniform {
+    double vmin;
+    double vmax;
+
+    double operator()() const { return spark::random::uniform(vmin, vmax); }
+
+    void sample(std::span<double> values) const {
+        spark::random::fill_uniform(values);
+        const size_t n = values.size();
+        double* out = values.data();
+#pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+            out[i] = vmin + (vmax - vmin) * out[i];
+    }
+};
+
+struct SingleValue {
+    double value;
+
+    double operator()() const { return value; }
+
+    void sample(std::span<double> values) const {
+        for (auto& v : values)
+            v = value;
+    }
+};
+
+inline double maxwellian_flux(const double std, const double drift) {
+    return std * sqrt(-2 * log(spark::random::uniform())) + drift;
+}
+
+// Normal component of the velocity of the particles of a Maxwellian crossing a surface
+struct MaxwellFlux {
+    double vth;
+    double drift;
+
+    double operator()() const { return maxwellian_flux(vth, drift); }
+
+    void sample(std::span<double> values) const {
+        spark::random::fill_uniform(values);
+        const size_t n = values.size();
+        double* out = values.data();
+        // 1 - u is in (0, 1]
+#pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+            out[i] = vth * std::sqrt(-2.0 * std::log(1.0 - out[i])) + drift;
+    }
+};
+
+// Histogram of a measured spectrum, e.g. of energies or angles: bin i spans [edges[i], edges[i+1])
+// and is drawn with a probability proportional to weights[i], by an alias table, after which the
+// value is uniform within the bin. A sample costs one random number whatever the number of bins.
+class Tabulated {
+public:
+    Tabulated() = default;
+    Tabulated(std::span<const double> edges, std::span<const double> weights);
+
+    double operator()() const { return value(spark::random::uniform()); }
+
+    void sample(std::span<double> values) const {
+        spark::random::fill_uniform(values);
+        const size_t n = values.size();
+        double* out = values.data();
+        for (size_t i = 0; i < n; ++i)
+            out[i] = value(out[i]);
+    }
+
+    // Value for the uniform u in [0,1)
+    double value(double u) const {
+        double rest;
+        const size_t bin = bins_.sample(u, rest);
+        return edges_[bin] + rest * (edges_[bin + 1] - edges_[bin]);
+    }
+
+    const random::AliasTable& bins() const { return bins_; }
+
+private:
+    random::AliasTable bins_;
+    std::vector<double> edges_;
+};
+
+// Continuous distribution over the domain of a grid whose density is the multilinear
+// interpolation of the non-negative values at its nodes, the weighting of the particles to the
+// grid, e.g. a map of the ionization rate as a spatial source of particles. A cell is drawn by an
+// alias table with a probability proportional to the mean of its corners, and the position within
+// it exactly, as the density of a cell is a mixture of one product of linear densities per
+// corner. A sample costs N + 1 random numbers and returns a core::Vec<N>.
+template <unsigned N>
+class GridDistribution {
+public:
+    GridDistribution() = default;
+    explicit GridDistribution(const spatial::UniformGrid<N>& grid);
+
+    core::Vec<N> operator()() const {
+        double u[N + 1];
+        for (auto& ui : u)
+            ui = spark::random::uniform();
+        return value(u);
+    }
+
+    void sample(std::span<core::Vec<N>> values);
+
+    // Position for the N + 1 uniforms u in [0,1)
+    core::Vec<N> value(const double* u) const;
+
+    // Integral of the interpolated values over the domain, e.g. the number of particles created
+    // per second by a rate density
+    double integral() const { return integral_; }
+
+private:
+    static constexpr unsigned n_corners = 1u << N;
+
+    // Node of the lower corner of a cell, and node of one of its corners, bit d of the corner
+    // selecting the upper node along axis d
+    size_t first_node(size_t cell) const;
+    size_t corner_node(size_t first, unsigned corner) const;
+
+    random::AliasTable cells_;
+    std::vector<double> nodes_;
+    // Cells per axis, and strides of the nodes in the row-major order of the grid
+    std::array<size_t, N> n_cells_ = {};
+    std::array<size_t, N> strides_ = {};
+    core::Vec<N> dx_;
+    double integral_ = 0.0;
+    std::vector<double> uniforms_;
+};
+
 inline auto maxwell(const double temperature, const double mass, const double drift = 0) {
-    const double vth = std::sqrt(spark::constants::e * temperature / mass);
-    return [vth, drift]() { return spark::random::normal(drift, vth); };
+    return Maxwell{std::sqrt(spark::constants::e * temperature / mass), drift};
+}
+
+inline auto maxwell_flux(const double temperature, const double mass, const double drift = 0) {
+    return MaxwellFlux{std::sqrt(spark::constants::e * temperature / mass), drift};
 }
 
 inline auto uniform(const double vmin, const double vmax) {
-    return [vmin, vmax]() { return spark::random::uniform(vmin, vmax); };
+    return Uniform{vmin, vmax};
 }
 
 inline auto single_value(const double val) {
-    return [val]() { return val; };
+    return SingleValue{val};
 }
 
-inline double maxwellian_flux(const double std, const double drift) {
-    return std * sqrt(-2 * log(spark::random::uniform())) + drift;
+inline auto tabulated(std::span<const double> edges, std::span<const double> weights) {
+    return Tabulated(edges, weights);
+}
+
+template <unsigned N>
+inline auto grid_source(const spatial::UniformGrid<N>& grid) {
+    return GridDistribution<N>(grid);
 }
 
 }  // namespace distributions
@@ -45,6 +208,49 @@ protected:
     double rate_ = 0;
 };
 
+namespace detail {
+
+// Samples a distribution of single values into samples, in a batch when it provides one
+template <typename D>
+void sample_values(D& distribution, std::vector<double>& samples) {
+    if constexpr (requires { distribution.sample(std::span<double>(samples)); }) {
+        distribution.sample(samples);
+    } else {
+        for (auto& sample : samples)
+            sample = distribution();
+    }
+}
+
+template <size_t I, unsigned N>
+double& component(core::Vec<N>& vec) {
+    if constexpr (I == 0)
+        return vec.x;
+    else if constexpr (I == 1)
+        return vec.y;
+    else
+        return vec.z;
+}
+
+template <size_t I, unsigned N>
+void write_component(const std::vector<double>& samples, core::Vec<N>* out) {
+    const size_t n = samples.size();
+    for (size_t i = 0; i < n; ++i)
+        component<I>(out[i]) = samples[i];
+}
+
+inline size_t n_emitted(double n) {
+    const double fn = std::floor(n);
+    return static_cast<size_t>(spark::random::uniform() <= (n - fn) ? fn + 1 : fn);
+}
+
+}  // namespace detail
+
+// Distribution of whole positions, e.g. distributions::GridDistribution
+template <typename S, unsigned NX>
+concept PositionDistribution = requires(S& source) {
+    { source() } -> std::convertible_to<core::Vec<NX>>;
+};
+
 template <unsigned NX, unsigned NV, typename... Args>
     requires(sizeof...(Args) == NX + NV)
 class IndividualComponentEmitter : public Emitter<NX, NV> {
@@ -52,31 +258,79 @@ class IndividualComponentEmitter : public Emitter<NX, NV> {
 
 public:
     IndividualComponentEmitter(double rate, Args&&... distributions)
-        : super(rate), distributions_(std::make_tuple(std::forward<Args>(distributions)...)) {}
+        : super(rate), distributions_(std::forward<Args>(distributions)...) {}
 
+    // The particles are appended first and each component is then sampled for all of them at once
+    // into a scratch buffer, which is copied to the species
     void emit(Species<NX, NV>& species, double n) override {
-        double fn = floor(n);
-        int np = spark::random::uniform() <= (n - fn) ? fn + 1 : fn;
-
-        species.add(np, [this](auto& v, auto& x) {
-            if constexpr (NX > 0)
-                x.x = std::get<0>(distributions_)();
-            if constexpr (NX > 1)
-                x.y = std::get<1>(distributions_)();
-            if constexpr (NX > 2)
-                x.z = std::get<2>(distributions_)();
-
-            if constexpr (NV > 0)
-                v.x = std::get<NX + 0>(distributions_)();
-            if constexpr (NV > 1)
-                v.x = std::get<NX + 1>(distributions_)();
-            if constexpr (NV > 2)
-                v.x = std::get<NX + 2>(distributions_)();
-        });
+        const size_t np = detail::n_emitted(n);
+        if (np == 0)
+            return;
+
+        const size_t first = species.n();
+        species.add(np);
+        samples_.resize(np);
+
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            (sample_component<Is>(species, first), ...);
+        }(std::make_index_sequence<NX + NV>{});
     }
 
 private:
-    std::tuple<Args...> distributions_;
+    template <size_t I>
+    void sample_component(Species<NX, NV>& species, size_t first) {
+        detail::sample_values(std::get<I>(distributions_), samples_);
+        if constexpr (I < NX)
+            detail::write_component<I>(samples_, species.x() + first);
+        else
+            detail::write_component<I - NX>(samples_, species.v() + first);
+    }
+
+    std::tuple<std::decay_t<Args>...> distributions_;
+    std::vector<double> samples_;
+};
+
+// Positions drawn from a distribution of whole positions, e.g. a spatial source map, and velocity
+// components from individual distributions
+template <unsigned NX, unsigned NV, typename S, typename... Args>
+    requires(sizeof...(Args) == NV && PositionDistribution<S, NX>)
+class SourceEmitter : public Emitter<NX, NV> {
+    using super = Emitter<NX, NV>;
+
+public:
+    SourceEmitter(double rate, S&& source, Args&&... distributions)
+        : super(rate),
+          source_(std::forward<S>(source)),
+          distributions_(std::forward<Args>(distributions)...) {}
+
+    void emit(Species<NX, NV>& species, double n) override {
+        const size_t np = detail::n_emitted(n);
+        if (np == 0)
+            return;
+
+        const size_t first = species.n();
+        species.add(np);
+
+        auto* x = species.x() + first;
+        if constexpr (requires { source_.sample(std::span<core::Vec<NX>>(x, np)); }) {
+            source_.sample(std::span<core::Vec<NX>>(x, np));
+        } else {
+            for (size_t i = 0; i < np; ++i)
+                x[i] = source_();
+        }
+
+        samples_.resize(np);
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            ((detail::sample_values(std::get<Is>(distributions_), samples_),
+              detail::write_component<Is>(samples_, species.v() + first)),
+             ...);
+        }(std::make_index_sequence<NV>{});
+    }
+
+private:
+    std::decay_t<S> source_;
+    std::tuple<std::decay_t<Args>...> distributions_;
+    std::vector<double> samples_;
 };
 
 template <unsigned NX, unsigned NV, typename F>
@@ -88,10 +342,7 @@ public:
         : super(rate), distribution_(std::forward<F>(distribution)) {}
 
     void emit(Species<NX, NV>& species, double n) override {
-        double fn = floor(n);
-        int np = spark::random::uniform() <= (n - fn) ? fn + 1 : fn;
-
-        species.add(np, [this](auto& v, auto& x) {
+        species.add(detail::n_emitted(n), [this](auto& v, auto& x) {
             const auto sample = distribution_();
             x = std::get<0>(sample);
             v = std::get<1>(sample);
@@ -103,19 +354,37 @@ private:
 };
 
 template <unsigned NX, unsigned NV, typename... Args>
-    requires(sizeof...(Args) == NX + NV)
+    requires(sizeof...(Args) == NX + NV &&
+             !PositionDistribution<std::tuple_element_t<0, std::tuple<Args...>>, NX>)
 inline Emitter<NX, NV>::Ref make_emitter(Args&&... individual_distributions) {
     return std::make_unique<IndividualComponentEmitter<NX, NV, Args...>>(
         0, std::forward<Args>(individual_distributions)...);
 }
 
 template <unsigned NX, unsigned NV, typename... Args>
-    requires(sizeof...(Args) == NX + NV)
+    requires(sizeof...(Args) == NX + NV &&
+             !PositionDistribution<std::tuple_element_t<0, std::tuple<Args...>>, NX>)
 inline Emitter<NX, NV>::Ref make_emitter(double rate, Args&&... individual_distributions) {
     return std::make_unique<IndividualComponentEmitter<NX, NV, Args...>>(
         rate, std::forward<Args>(individual_distributions)...);
 }
 
+template <unsigned NX, unsigned NV, typename S, typename... Args>
+    requires(sizeof...(Args) == NV && PositionDistribution<S, NX>)
+inline Emitter<NX, NV>::Ref make_emitter(S&& source, Args&&... velocity_distributions) {
+    return std::make_unique<SourceEmitter<NX, NV, S, Args...>>(
+        0, std::forward<S>(source), std::forward<Args>(velocity_distributions)...);
+}
+
+template <unsigned NX, unsigned NV, typename S, typename... Args>
+    requires(sizeof...(Args) == NV && PositionDistribution<S, NX>)
+inline Emitter<NX, NV>::Ref make_emitter(double rate,
+                                         S&& source,
+                                         Args&&... velocity_distributions) {
+    return std::make_unique<SourceEmitter<NX, NV, S, Args...>>(
+        rate, std::forward<S>(source), std::forward<Args>(velocity_distributions)...);
+}
+
 template <unsigned NX, unsigned NV, typename F>
 inline Emitter<NX, NV>::Ref make_emitter(F&& combined_distribution) {
     return std::make_unique<CombinedComponentEmitter<NX, NV, F>>(
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <vector>
 
 #include "spark/core/vec.h"
@@ -21,6 +22,7 @@ public:
         const auto n_current = x_.size();
         v_.resize(n_current + n);
         x_.resize(n_current + n);
+        add_collision_times(n_current);
     }
 
     void add(size_t n, auto sampler) {
@@ -32,6 +34,8 @@ public:
         for (size_t i = n_current; i < n_current + n; ++i) {
             sampler(v_[i], x_[i]);
         }
+
+        add_collision_times(n_current);
     }
 
     template <auto SamplerFunc(core::Vec<NV>&, core::Vec<NX>&)->void>
@@ -44,11 +48,14 @@ public:
         for (size_t i = n_current; i < n_current + n; ++i) {
             SamplerFunc(v_[i], x_[i]);
         }
+
+        add_collision_times(n_current);
     }
 
     void add_copy(size_t idx) {
         v_.push_back(v_[idx]);
         x_.push_back(x_[idx]);
+        add_collision_times(x_.size() - 1);
     }
 
     void remove(size_t idx) {
@@ -57,12 +64,68 @@ public:
 
         x_[idx] = x_.back();
         x_.pop_back();
+
+        if (has_collision_times_) {
+            collision_times_[idx] = collision_times_.back();
+            collision_times_.pop_back();
+            if (idx < x_.size())
+                log_change(idx);
+        }
+    }
+
+    // Optional time of the next collision candidate of each particle, in the units of the
+    // collision engine that enabled it. It is moved along with the particles, and particles added
+    // after it was enabled start unscheduled (NaN).
+    void enable_collision_times() {
+        if (has_collision_times_)
+            return;
+        has_collision_times_ = true;
+        collision_times_.assign(n(), std::numeric_limits<double>::quiet_NaN());
+        reordered_ = true;
+    }
+
+    bool has_collision_times() const { return has_collision_times_; }
+    double* collision_times() const { return const_cast<double*>(collision_times_.data()); }
+
+    // Indices whose particle was added or replaced since the last clear_changes, only tracked with
+    // collision times. Operations that move most particles set reordered() instead.
+    const std::vector<size_t>& changed() const { return changed_; }
+    bool reordered() const { return reordered_; }
+    void mark_reordered() { reordered_ = true; }
+    void clear_changes() {
+        changed_.clear();
+        reordered_ = false;
     }
 
 private:
+    void add_collision_times(size_t n_current) {
+        if (!has_collision_times_)
+            return;
+        collision_times_.resize(n(), std::numeric_limits<double>::quiet_NaN());
+        for (size_t i = n_current; i < n(); ++i)
+            log_change(i);
+    }
+
+    void log_change(size_t idx) {
+        if (reordered_)
+            return;
+        // Past the population size a full rescan is cheaper than the log
+        if (changed_.size() >= n()) {
+            reordered_ = true;
+            changed_.clear();
+            return;
+        }
+        changed_.push_back(idx);
+    }
+
     std::vector<core::Vec<NV>> v_;
     std::vector<core::Vec<NX>> x_;
     double m_ = 0;
+
+    bool has_collision_times_ = false;
+    std::vector<double> collision_times_;
+    std::vector<size_t> changed_;
+    bool reordered_ = false;
 };
 
 template <unsigned NX, unsigned NV>
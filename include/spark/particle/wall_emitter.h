@@ -0,0 +1,64 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "spark/particle/boundary.h"
+#include "spark/particle/emitter.h"
+#include "spark/random/alias_table.h"
+
+namespace spark::particle {
+
+struct WallEmitterConfig {
+    // Temperature [eV] of the emitted flux, whose thermal speed uses the mass of the species
+    double temperature;
+    // Time step [s]. When positive, each particle is pushed along its velocity by a uniformly
+    // distributed fraction of it, as if emitted at a random time within the last step, so that the
+    // particles do not bunch at the wall. The push is traced through the tiles of the emitter built
+    // from a TiledBoundary2D, which handles the hits as in its apply(). With a list of faces it is
+    // not checked, and particles pushed across a tile end up inside it.
+    double dt = 0.0;
+};
+
+// Injects particles through the exposed faces of TiledBoundary2D tiles, e.g. thermionic emission,
+// secondary electrons or gas inlets. The face of each particle is drawn by an alias table with a
+// probability proportional to its area and the position along it uniformly, and the velocity is
+// the one of a Maxwellian flux crossing the face: a flux Maxwellian along the outward normal and
+// Maxwellians along the tangent and z. The particles start just off the wall, in the empty cell.
+class WallEmitter : public Emitter<2, 3> {
+public:
+    WallEmitter(double rate, std::vector<BoundaryFace> faces, const WallEmitterConfig& config);
+
+    // Faces of tile `boundary` of the tiled boundary, which must outlive the emitter
+    WallEmitter(double rate,
+                TiledBoundary2D& tiles,
+                int boundary,
+                const WallEmitterConfig& config);
+
+    void emit(Species<2, 3>& species, double n) override;
+    using Emitter<2, 3>::emit;
+
+    // Called for the hits of the tiles during the push, as the callback of TiledBoundary2D::apply
+    void set_callback(TiledBoundary2D::Callback on_hit) { on_hit_ = std::move(on_hit); }
+
+    const std::vector<BoundaryFace>& faces() const { return faces_; }
+
+    // Total area of the faces per unit depth [m], e.g. to convert a current density to a rate
+    double area() const { return faces_table_.total(); }
+
+private:
+    std::vector<BoundaryFace> faces_;
+    TiledBoundary2D* tiles_ = nullptr;
+    TiledBoundary2D::Callback on_hit_;
+    random::AliasTable faces_table_;
+    WallEmitterConfig config_;
+    // Distance from the wall at which the particles start
+    double offset_ = 0.0;
+
+    std::vector<double> uniforms_;
+    std::vector<double> normal_;
+    std::vector<double> tangential_;
+    std::vector<size_t> removed_;
+};
+
+}  // namespace spark::particle
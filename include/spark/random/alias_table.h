@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "spark/random/random.h"
+
+namespace spark::random {
+
+// Discrete distribution over the indices of a table of non-negative weights, sampled in O(1) by
+// Walker's alias method and built in O(n) by Vose's algorithm (M. D. Vose, IEEE Trans. Softw. Eng.
+// 17, 972 (1991)). Index i of the table is drawn with probability weights[i] / total().
+class AliasTable {
+public:
+    AliasTable() = default;
+    explicit AliasTable(std::span<const double> weights);
+
+    size_t size() const { return prob_.size(); }
+    bool empty() const { return prob_.empty(); }
+
+    // Sum of the weights
+    double total() const { return total_; }
+
+    // Index for the uniform u in [0,1). The part of u left unused by the choice is returned in
+    // rest, uniform in [0,1) and independent of the index, so that a sample of a continuous
+    // variable within the chosen entry does not need another random number. It carries about
+    // log2(size()) bits less than u.
+    size_t sample(double u, double& rest) const {
+        const double x = u * static_cast<double>(prob_.size());
+        const size_t j = std::min(static_cast<size_t>(x), prob_.size() - 1);
+        const double f = x - static_cast<double>(j);
+        if (f < prob_[j]) {
+            rest = f / prob_[j];
+            return j;
+        }
+        rest = std::min((f - prob_[j]) / (1.0 - prob_[j]), max_rest_);
+        return alias_[j];
+    }
+
+    size_t sample(double u) const {
+        double rest;
+        return sample(u, rest);
+    }
+
+    size_t operator()() const { return sample(random::uniform()); }
+
+private:
+    static constexpr double max_rest_ = 1.0 - 0x1.0p-53;
+
+    std::vector<double> prob_;
+    std::vector<uint32_t> alias_;
+    double total_ = 0.0;
+};
+
+}  // namespace spark::random
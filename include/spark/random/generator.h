@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace spark::random {
+
+// xoshiro256+ pseudo-random generator (Blackman and Vigna, 2018) as an object, so that independent
+// streams can be owned by threads, tiles or chunks of work. jump() advances the state by 2^128
+// draws and long_jump() by 2^192, which splits the period into non-overlapping streams.
+class Generator {
+public:
+    using State = std::array<uint64_t, 4>;
+
+    // The default state is the one of seed 0
+    Generator() = default;
+    explicit Generator(uint64_t seed) { this->seed(seed); }
+
+    // Seeds the state with splitmix64, as advised by the authors of xoshiro256+
+    void seed(uint64_t seed);
+
+    // Equivalent to 2^128 calls to uniform_u64()
+    void jump();
+    // Equivalent to 2^192 calls to uniform_u64()
+    void long_jump();
+
+    // Uniform random uint64
+    uint64_t uniform_u64() {
+        const uint64_t result = s_[0] + s_[3];
+        const uint64_t t = s_[1] << 17;
+
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = (s_[3] << 45) | (s_[3] >> 19);
+
+        return result;
+    }
+
+    // Uniform random double in the range [0,1), from the upper 53 bits
+    double uniform() { return static_cast<double>(uniform_u64() >> 11) * 0x1.0p-53; }
+
+    // Normally distributed random double with mean of 0 and standard deviation of 1
+    double normal();
+
+    double normal(double mean, double std) { return std * normal() + mean; }
+
+    // Fill values with uniform random doubles in the range [0,1) and with standard normal doubles.
+    // Large fills draw from interleaved lanes of xoshiro256+ seeded from this generator, which
+    // are vectorized with AVX2 or AVX-512 when the CPU supports them, so they yield a different
+    // sequence than repeated scalar calls.
+    void fill_uniform(std::span<double> values);
+    void fill_normal(std::span<double> values);
+
+    // The state, e.g. for checkpoints
+    const State& state() const { return s_; }
+    void set_state(const State& state) { s_ = state; }
+
+private:
+    State s_ = {0xe220a8397b1dcdaf, 0x6e789e6aa1b965f4, 0x06c45d188009454f, 0xf88bb8a8724c81ec};
+};
+
+// Non-overlapping streams of a single seed, stream i starting i jumps after it. Parallel kernels
+// hand one stream to each thread, tile or chunk of work, so their outcome depends neither on the
+// number of threads nor on the scheduling, and no two streams share a subsequence.
+class StreamPool {
+public:
+    StreamPool() = default;
+    explicit StreamPool(uint64_t seed, size_t n_streams = 0);
+
+    // Adds streams up to n, continuing the jump sequence. Existing streams are kept.
+    void resize(size_t n);
+
+    size_t size() const { return streams_.size(); }
+    bool empty() const { return streams_.empty(); }
+
+    Generator& operator[](size_t i) { return streams_[i]; }
+    const Generator& operator[](size_t i) const { return streams_[i]; }
+
+private:
+    Generator next_;
+    std::vector<Generator> streams_;
+};
+
+// Binds a stream to the free functions of the calling thread (random::uniform(), normal(), ...)
+// for the lifetime of the object, and restores the previous state on destruction. The stream
+// advances by the numbers drawn and is not to be used directly while bound. With backends other
+// than xoshiro256+ the thread's generator is instead reseeded from the stream.
+class ScopedStream {
+public:
+    explicit ScopedStream(Generator& stream);
+    ~ScopedStream();
+
+    ScopedStream(const ScopedStream&) = delete;
+    ScopedStream& operator=(const ScopedStream&) = delete;
+
+private:
+    Generator* stream_;
+    Generator::State saved_;
+};
+
+}  // namespace spark::random
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "spark/constants/constants.h"
+
+namespace spark::random {
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11). Ten rounds of a keyed bijection
+// map a 128-bit counter to 128 random bits, so each random number is a pure function of the seed
+// and of its counter, and can be computed directly on any thread and in any order. The keyed
+// draws below use the counter (n, step, id): the n-th pair of 64-bit words of the entity id
+// (particle, cell, pair, ...) in time step `step`. Results computed from them are reproduced bit
+// for bit regardless of the number of threads and of how the work is split.
+class Philox {
+public:
+    using Block = std::array<uint32_t, 4>;
+
+    Philox() = default;
+    explicit Philox(uint64_t seed)
+        : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    uint64_t seed() const { return static_cast<uint64_t>(key_[1]) << 32 | key_[0]; }
+
+    // The bijection, on scalars so that loops over counters vectorize. The words are uint32_t, or
+    // uint64_t holding 32-bit values, which vectorizes better as the 64-bit products of the rounds
+    // then stay in the lanes of their factors.
+    template <typename T>
+    static void bijection(T& c0, T& c1, T& c2, T& c3, uint32_t k0, uint32_t k1) {
+        // Unrolled, so that the loops over counters calling it are vectorized
+#pragma GCC unroll 10
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = uint64_t{0xD2511F53} * static_cast<uint32_t>(c0);
+            const uint64_t p1 = uint64_t{0xCD9E8D57} * static_cast<uint32_t>(c2);
+            c0 = static_cast<T>(p1 >> 32) ^ c1 ^ k0;
+            c1 = static_cast<uint32_t>(p1);
+            c2 = static_cast<T>(p0 >> 32) ^ c3 ^ k1;
+            c3 = static_cast<uint32_t>(p0);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+    }
+
+    Block operator()(Block ctr) const {
+        bijection(ctr[0], ctr[1], ctr[2], ctr[3], key_[0], key_[1]);
+        return ctr;
+    }
+
+    // Pair n of 64-bit words of entity id in step
+    void words(uint32_t step, uint64_t id, uint32_t n, uint64_t& w0, uint64_t& w1) const {
+        uint64_t c0 = n;
+        uint64_t c1 = step;
+        uint64_t c2 = id & 0xffffffff;
+        uint64_t c3 = id >> 32;
+        bijection(c0, c1, c2, c3, key_[0], key_[1]);
+        w0 = c1 << 32 | c0;
+        w1 = c3 << 32 | c2;
+    }
+
+    std::array<uint64_t, 2> words(uint32_t step, uint64_t id, uint32_t n) const {
+        std::array<uint64_t, 2> w;
+        words(step, id, n, w[0], w[1]);
+        return w;
+    }
+
+    // Pair n of uniform doubles in the range [0,1) of entity id in step
+    std::array<double, 2> uniform(uint32_t step, uint64_t id, uint32_t n) const {
+        const auto w = words(step, id, n);
+        return {static_cast<double>(w[0] >> 11) * 0x1.0p-53,
+                static_cast<double>(w[1] >> 11) * 0x1.0p-53};
+    }
+
+    // Pair n of standard normal doubles of entity id in step, by the Box-Muller transform
+    std::array<double, 2> normal(uint32_t step, uint64_t id, uint32_t n) const {
+        const auto u = uniform(step, id, n);
+        const double r = std::sqrt(-2.0 * std::log1p(-u[0]));
+        const double phi = 2.0 * constants::pi * u[1];
+        return {r * std::cos(phi), r * std::sin(phi)};
+    }
+
+    // First uniform of pair n of the entities first_id, first_id + 1, ... in step, one per value
+    void fill_uniform(uint32_t step,
+                      uint64_t first_id,
+                      uint32_t n,
+                      std::span<double> values) const {
+        const size_t size = values.size();
+        double* out = values.data();
+#pragma omp simd
+        for (size_t i = 0; i < size; ++i) {
+            uint64_t w0, w1;
+            words(step, first_id + i, n, w0, w1);
+            out[i] = static_cast<double>(w0 >> 11) * 0x1.0p-53;
+        }
+    }
+
+private:
+    std::array<uint32_t, 2> key_ = {0, 0};
+};
+
+// Sequence of the keyed draws of one entity in one step, with the interface of Generator. It
+// suits the code that draws a varying number of values per entity, e.g. the rejection loops of
+// the samplers, while staying a function of (seed, step, id).
+class PhiloxStream {
+public:
+    PhiloxStream() = default;
+    PhiloxStream(const Philox& philox, uint32_t step, uint64_t id)
+        : philox_(philox), step_(step), id_(id) {}
+
+    uint64_t uniform_u64() {
+        if (position_ % 2 == 0)
+            words_ = philox_.words(step_, id_, position_ / 2);
+        return words_[position_++ % 2];
+    }
+
+    // Uniform random double in the range [0,1), from the upper 53 bits
+    double uniform() { return static_cast<double>(uniform_u64() >> 11) * 0x1.0p-53; }
+
+    // Normally distributed random double with mean of 0 and standard deviation of 1, by ziggurat
+    double normal();
+
+    double normal(double mean, double std) { return std * normal() + mean; }
+
+    // Vectorized over the counters, as Generator::fill_uniform and fill_normal
+    void fill_uniform(std::span<double> values);
+    void fill_normal(std::span<double> values);
+
+    const Philox& philox() const { return philox_; }
+    uint32_t step() const { return step_; }
+    uint64_t id() const { return id_; }
+
+    // Number of 64-bit words drawn
+    uint32_t position() const { return position_; }
+    void set_position(uint32_t position) {
+        position_ = position;
+        if (position_ % 2 != 0)
+            words_ = philox_.words(step_, id_, position_ / 2);
+    }
+
+private:
+    // Skips the second word of a partly drawn counter, so that the vectorized fills start on a
+    // counter and no word is drawn twice
+    void align() {
+        if (position_ % 2 != 0)
+            ++position_;
+    }
+
+    Philox philox_;
+    uint32_t step_ = 0;
+    uint64_t id_ = 0;
+    uint32_t position_ = 0;
+    std::array<uint64_t, 2> words_ = {0, 0};
+};
+
+}  // namespace spark::random
@@ -2,12 +2,18 @@
 
 #include <stdint.h>
 
+#include <span>
+
+#include "spark/random/generator.h"
+
 namespace spark::random {
 
 // Generates a pseudo-random seed based on std::time
 uint64_t gen_seed();
 
-// Initialize pseudo-random generator
+// Initialize pseudo-random generator of the calling thread. The generator state is thread local,
+// so every thread that draws random numbers has to be initialized. Parallel kernels draw from a
+// StreamPool instead, binding a stream with ScopedStream.
 void initialize(uint64_t seed);
 
 // Uniform random uint64
@@ -19,6 +25,12 @@ double uniform();
 // Normally distributed random double with mean of 0 and standard deviation of 1
 double normal();
 
+// Fill values with uniform random doubles in the range [0,1) and with normally distributed doubles
+// of mean 0 and standard deviation 1. Large fills are vectorized (see Generator::fill_uniform), so
+// consumers of many numbers draw them in bulk.
+void fill_uniform(std::span<double> values);
+void fill_normal(std::span<double> values);
+
 // Normally distributed random double with specified mean and standard deviation
 inline double normal(double mean, double std) {
     return std * normal() + mean;
@@ -0,0 +1,247 @@
+#include "spark/collisions/coulomb.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "spark/collisions/scattering.h"
+#include "spark/constants/constants.h"
+#include "spark/random/random.h"
+
+using namespace spark::collisions;
+
+namespace {
+
+// 1 - cos(chi) of the cumulative small angle deflection for the scattering parameter s, where u
+// is uniform in (0, 1] (Nanbu, Phys. Rev. E 55, 4642 (1997))
+double nanbu_one_minus_cos(const double s, const double u) {
+    if (s < 0.01)
+        return -s * std::log(u);
+
+    if (s >= 6.0)
+        return 2.0 * (1.0 - u);
+
+    double a;
+    if (s < 3.0) {
+        const double inv_a =
+            0.0056958 +
+            s * (0.9560202 +
+                 s * (-0.508139 + s * (0.47913906 + s * (-0.12788975 + s * 0.02389567))));
+        a = 1.0 / inv_a;
+    } else {
+        a = 3.0 * std::exp(-s);
+    }
+
+    const double cos_chi = std::log(std::exp(-a) + 2.0 * u * std::sinh(a)) / a;
+    return 1.0 - std::clamp(cos_chi, -1.0, 1.0);
+}
+
+void shuffle(std::vector<size_t>& v) {
+    for (size_t i = v.size(); i > 1; --i) {
+        const auto j = std::min(static_cast<size_t>(spark::random::uniform() * i), i - 1);
+        std::swap(v[i - 1], v[j]);
+    }
+}
+
+}  // namespace
+
+// Pairs of a chunk of cells grouped in rounds. A particle appears at most once per round, so the
+// pairs of a round can be processed independently of each other.
+template <unsigned NX, unsigned NV>
+struct CoulombCollisions<NX, NV>::Pairs {
+    struct Round {
+        std::vector<size_t> ia, ib;
+        // Density of the collision partners times the time step
+        std::vector<double> n_dt;
+    };
+
+    std::vector<Round> rounds;
+    std::vector<size_t> order_a, order_b;
+
+    std::vector<core::Vec<3>> u, du;
+    std::vector<double> r1, r2;
+
+    void add(const size_t round, const size_t ia, const size_t ib, const double n_dt) {
+        if (rounds.size() <= round)
+            rounds.resize(round + 1);
+        rounds[round].ia.push_back(ia);
+        rounds[round].ib.push_back(ib);
+        rounds[round].n_dt.push_back(n_dt);
+    }
+};
+
+template <unsigned NX, unsigned NV>
+CoulombCollisions<NX, NV>::CoulombCollisions(const spatial::GridProp<NX>& grid,
+                                             const CoulombConfig& config)
+    : config_(config), index_a_(grid), index_b_(grid), streams_(random::uniform_u64()) {}
+
+template <unsigned NX, unsigned NV>
+void CoulombCollisions<NX, NV>::collide(particle::ChargedSpecies<NX, NV>& species) {
+    index_a_.sort(species);
+    particle::for_each_cell_chunk(index_a_, streams_, config_.parallel,
+                                  [&](size_t, size_t begin, size_t end) {
+                                      collide_cells(species, nullptr, begin, end);
+                                  });
+}
+
+template <unsigned NX, unsigned NV>
+void CoulombCollisions<NX, NV>::collide(particle::ChargedSpecies<NX, NV>& a,
+                                        particle::ChargedSpecies<NX, NV>& b) {
+    index_a_.sort(a);
+    index_b_.sort(b);
+    particle::for_each_cell_chunk(
+        index_a_, streams_, config_.parallel,
+        [&](size_t, size_t begin, size_t end) { collide_cells(a, &b, begin, end); });
+}
+
+template <unsigned NX, unsigned NV>
+void CoulombCollisions<NX, NV>::collide_cells(particle::ChargedSpecies<NX, NV>& a,
+                                              particle::ChargedSpecies<NX, NV>* b,
+                                              const size_t begin,
+                                              const size_t end) {
+    Pairs pairs;
+    const double dt = config_.dt;
+    const double density_per_particle = config_.weight / index_a_.cell_volume();
+
+    for (size_t cell = begin; cell < end; ++cell) {
+        const auto particles_a = index_a_.particles(cell);
+        pairs.order_a.assign(particles_a.begin(), particles_a.end());
+        shuffle(pairs.order_a);
+        const auto& pa = pairs.order_a;
+        const size_t na = pa.size();
+
+        if (!b) {
+            if (na < 2)
+                continue;
+
+            const double n_dt = static_cast<double>(na) * density_per_particle * dt;
+            size_t first = 0;
+
+            // With an odd number of particles the first three collide pairwise for half a step
+            if (na % 2 == 1) {
+                pairs.add(0, pa[0], pa[1], 0.5 * n_dt);
+                pairs.add(1, pa[1], pa[2], 0.5 * n_dt);
+                pairs.add(2, pa[2], pa[0], 0.5 * n_dt);
+                first = 3;
+            }
+
+            for (size_t i = first; i + 1 < na; i += 2)
+                pairs.add(0, pa[i], pa[i + 1], n_dt);
+
+            continue;
+        }
+
+        const auto particles_b = index_b_.particles(cell);
+        pairs.order_b.assign(particles_b.begin(), particles_b.end());
+        shuffle(pairs.order_b);
+        const auto& pb = pairs.order_b;
+        const size_t nb = pb.size();
+
+        if (na == 0 || nb == 0)
+            continue;
+
+        // Every particle of the more numerous species collides once, the others repeatedly, each
+        // time with the density of the less numerous species
+        const double n_dt = static_cast<double>(std::min(na, nb)) * density_per_particle * dt;
+        if (na >= nb) {
+            for (size_t i = 0; i < na; ++i)
+                pairs.add(i / nb, pa[i], pb[i % nb], n_dt);
+        } else {
+            for (size_t i = 0; i < nb; ++i)
+                pairs.add(i / na, pa[i % na], pb[i], n_dt);
+        }
+    }
+
+    apply(a, b ? *b : a, pairs);
+}
+
+template <unsigned NX, unsigned NV>
+void CoulombCollisions<NX, NV>::apply(particle::ChargedSpecies<NX, NV>& a,
+                                      particle::ChargedSpecies<NX, NV>& b,
+                                      Pairs& pairs) const {
+    auto* va = a.v();
+    auto* vb = b.v();
+
+    const double m_ab = a.m() * b.m() / (a.m() + b.m());
+    const double ratio_a = m_ab / a.m();
+    const double ratio_b = m_ab / b.m();
+
+    // <delta^2> = q_a^2 q_b^2 n lnL dt / (8 pi eps0^2 m_ab^2 u^3) for the Takizuka-Abe kernel and
+    // s = 2 <delta^2> for the Nanbu kernel
+    const double qq = a.q() * b.q();
+    const double factor = qq * qq * config_.coulomb_log /
+                          (8.0 * constants::pi * constants::eps0 * constants::eps0 * m_ab * m_ab);
+    const bool takizuka_abe = config_.kernel == CoulombKernel::TakizukaAbe;
+
+    for (auto& round : pairs.rounds) {
+        const size_t n = round.ia.size();
+        const size_t* ia = round.ia.data();
+        const size_t* ib = round.ib.data();
+        const double* n_dt = round.n_dt.data();
+
+        pairs.u.resize(n);
+        pairs.du.resize(n);
+        pairs.r1.resize(n);
+        pairs.r2.resize(n);
+        auto* u = pairs.u.data();
+        auto* du = pairs.du.data();
+        auto* r1 = pairs.r1.data();
+        auto* r2 = pairs.r2.data();
+
+        for (size_t k = 0; k < n; ++k) {
+            const auto& v1 = va[ia[k]];
+            const auto& v2 = vb[ib[k]];
+            u[k] = {v1.x - v2.x, v1.y - v2.y, v1.z - v2.z};
+        }
+
+        if (takizuka_abe) {
+            random::fill_normal({r1, n});
+        } else {
+            random::fill_uniform({r1, n});
+#pragma omp simd
+            for (size_t k = 0; k < n; ++k)
+                r1[k] = 1.0 - r1[k];
+        }
+        random::fill_uniform({r2, n});
+
+        if (takizuka_abe) {
+#pragma omp simd
+            for (size_t k = 0; k < n; ++k) {
+                const double u2 = u[k].x * u[k].x + u[k].y * u[k].y + u[k].z * u[k].z;
+                const double u3 = u2 * std::sqrt(u2);
+                const double delta = u3 > 0.0 ? r1[k] * std::sqrt(factor * n_dt[k] / u3) : 0.0;
+                const double d2 = delta * delta;
+                double cos_phi, sin_phi;
+                scattering::sincos_2pi(r2[k], cos_phi, sin_phi);
+                du[k] = scattering::rotation_delta(u[k], 2.0 * d2 / (1.0 + d2),
+                                                   2.0 * delta / (1.0 + d2), cos_phi, sin_phi);
+            }
+        } else {
+            for (size_t k = 0; k < n; ++k) {
+                const double u2 = u[k].x * u[k].x + u[k].y * u[k].y + u[k].z * u[k].z;
+                const double u3 = u2 * std::sqrt(u2);
+                const double one_minus_cos =
+                    u3 > 0.0 ? nanbu_one_minus_cos(2.0 * factor * n_dt[k] / u3, r1[k]) : 0.0;
+                const double sin_chi =
+                    std::sqrt(std::max(0.0, one_minus_cos * (2.0 - one_minus_cos)));
+                double cos_phi, sin_phi;
+                scattering::sincos_2pi(r2[k], cos_phi, sin_phi);
+                du[k] = scattering::rotation_delta(u[k], one_minus_cos, sin_chi, cos_phi, sin_phi);
+            }
+        }
+
+        for (size_t k = 0; k < n; ++k) {
+            auto& v1 = va[ia[k]];
+            auto& v2 = vb[ib[k]];
+            v1.x += ratio_a * du[k].x;
+            v1.y += ratio_a * du[k].y;
+            v1.z += ratio_a * du[k].z;
+            v2.x -= ratio_b * du[k].x;
+            v2.y -= ratio_b * du[k].y;
+            v2.z -= ratio_b * du[k].z;
+        }
+    }
+}
+
+template class spark::collisions::CoulombCollisions<1, 3>;
+template class spark::collisions::CoulombCollisions<2, 3>;
+template class spark::collisions::CoulombCollisions<3, 3>;
@@ -0,0 +1,137 @@
+#include "spark/collisions/cross_section_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "log/log.h"
+
+using namespace spark::collisions;
+
+double spark::collisions::interpolate_cross_section(const CrossSection& cs, const double energy) {
+    if (energy <= cs.energy.front())
+        return cs.cross_section.front();
+
+    if (energy >= cs.energy.back())
+        return cs.cross_section.back();
+
+    const auto it = std::lower_bound(cs.energy.begin(), cs.energy.end(), energy);
+
+    const size_t rhs = it - cs.energy.begin();
+
+    const double x0 = cs.energy[rhs - 1];
+    const double x1 = cs.energy[rhs];
+    const double y0 = cs.cross_section[rhs - 1];
+    const double y1 = cs.cross_section[rhs];
+
+    return y0 + (energy - x0) * (y1 - y0) / (x1 - x0);
+}
+
+CrossSectionTable::CrossSectionTable(const std::vector<const CrossSection*>& cross_sections,
+                                     const double energy_scale,
+                                     const CrossSectionTableConfig& config)
+    : grid_(config.grid), energy_scale_(energy_scale), n_reactions_(cross_sections.size()) {
+    if (cross_sections.empty())
+        return;
+
+    e_min_ = std::numeric_limits<double>::max();
+    e_max_ = 0.0;
+    for (const auto* cs : cross_sections) {
+        double e_first = cs->energy.front();
+        if (grid_ == EnergyGridType::LogUniform && e_first <= 0.0) {
+            // The grid cannot start at zero, so it is extended three decades below the first
+            // positive energy, where the remaining segment is close to constant in log space
+            const auto it = std::upper_bound(cs->energy.begin(), cs->energy.end(), 0.0);
+            e_first = 1e-3 * (it != cs->energy.end() ? *it : cs->energy.back());
+        }
+        e_min_ = std::min(e_min_, e_first / energy_scale_);
+        e_max_ = std::max(e_max_, cs->energy.back() / energy_scale_);
+    }
+
+    if (grid_ == EnergyGridType::LogUniform && e_min_ <= 0.0)
+        e_min_ = 1e-6;
+
+    if (e_max_ <= e_min_)
+        e_max_ = e_min_ + 1.0;
+
+    size_t n_points = std::max<size_t>(config.n_points, 2);
+    while (true) {
+        build(cross_sections, n_points);
+        error_ = eval_error(cross_sections);
+
+        if (error_ <= config.max_error || n_points >= config.max_points)
+            break;
+
+        n_points = std::min(2 * n_points, std::max<size_t>(config.max_points, 2));
+    }
+
+    if (error_ > config.max_error) {
+        SPARK_LOG_WARN(
+            "cross section table error %.3e exceeds the maximum of %.3e with %zu energy points",
+            error_, config.max_error, n_points_);
+    } else {
+        SPARK_LOG_INFO("cross section table with %zu energy points and error %.3e\n", n_points_,
+                       error_);
+    }
+}
+
+double CrossSectionTable::energy(const size_t i) const {
+    if (grid_ == EnergyGridType::Uniform)
+        return e0_ + static_cast<double>(i) / inv_de_;
+    return std::exp(e0_ + static_cast<double>(i) / inv_de_);
+}
+
+void CrossSectionTable::build(const std::vector<const CrossSection*>& cross_sections,
+                              const size_t n_points) {
+    n_points_ = n_points;
+    const double n_intervals = static_cast<double>(n_points_ - 1);
+
+    if (grid_ == EnergyGridType::Uniform) {
+        e0_ = e_min_;
+        inv_de_ = n_intervals / (e_max_ - e_min_);
+    } else {
+        e0_ = std::log(e_min_);
+        inv_de_ = n_intervals / (std::log(e_max_) - e0_);
+    }
+
+    data_.resize(n_points_ * n_reactions_);
+    for (size_t i = 0; i < n_points_; ++i) {
+        // Evaluating the last point directly avoids round-off past the end of the data
+        const double e = i == n_points_ - 1 ? e_max_ : energy(i);
+        double cumulative = 0.0;
+        for (size_t r = 0; r < n_reactions_; ++r) {
+            cumulative += interpolate_cross_section(*cross_sections[r], energy_scale_ * e);
+            data_[i * n_reactions_ + r] = cumulative;
+        }
+    }
+}
+
+double CrossSectionTable::eval_error(const std::vector<const CrossSection*>& cross_sections) const {
+    double max_total = 0.0;
+    for (size_t i = 0; i < n_points_; ++i)
+        max_total = std::max(max_total, total(i));
+
+    if (max_total <= 0.0)
+        return 0.0;
+
+    double max_diff = 0.0;
+    const auto eval_at = [&](const double e) {
+        const auto p = at(e);
+        double cumulative = 0.0;
+        for (size_t r = 0; r < n_reactions_; ++r) {
+            cumulative += interpolate_cross_section(*cross_sections[r], energy_scale_ * e);
+            max_diff = std::max(max_diff, std::abs(cumulative - this->cumulative(p, r)));
+        }
+    };
+
+    // The input data is piecewise linear, so the largest deviations are at its nodes or, for the
+    // logarithmic grid, in between table points
+    for (const auto* cs : cross_sections)
+        for (const double e : cs->energy)
+            eval_at(e / energy_scale_);
+
+    for (size_t i = 0; i < n_points_ - 1; ++i)
+        eval_at(0.5 * (energy(i) + energy(i + 1)));
+
+    return max_diff / max_total;
+}
@@ -0,0 +1,129 @@
+#include "spark/collisions/dsmc.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "spark/constants/constants.h"
+#include "spark/random/random.h"
+
+using namespace spark::collisions;
+
+template <unsigned NX, unsigned NV>
+DSMCCollisions<NX, NV>::DSMCCollisions(particle::Species<NX, NV>* species,
+                                       const spatial::GridProp<NX>& grid,
+                                       const DSMCConfig& config)
+    : species_(species), config_(config), cell_index_(grid), streams_(random::uniform_u64()) {
+    const auto& model = config_.model;
+    const double m_r = 0.5 * species_->m();
+
+    // sigma = pi d_ref^2 (2 k T_ref / (m_r g^2))^(omega - 1/2) / Gamma(5/2 - omega)
+    sigma_g_factor_ = constants::pi * model.d_ref * model.d_ref *
+                      std::pow(2.0 * constants::kb * model.t_ref / m_r, model.omega - 0.5) /
+                      std::tgamma(2.5 - model.omega);
+
+    // Number of candidate pairs per (sigma g)_max and N (N - 1) / 2
+    pair_factor_ = config_.weight * config_.dt / cell_index_.cell_volume();
+
+    const double g_mean =
+        std::sqrt(8.0 * constants::kb * config_.initial_temperature / (constants::pi * m_r));
+    sigma_g_max_.assign(cell_index_.n_cells(), sigma_g(2.0 * g_mean));
+}
+
+template <unsigned NX, unsigned NV>
+double DSMCCollisions<NX, NV>::sigma_g(const double g) const {
+    return sigma_g_factor_ * std::pow(g, 2.0 - 2.0 * config_.model.omega);
+}
+
+template <unsigned NX, unsigned NV>
+void DSMCCollisions<NX, NV>::collide() {
+    cell_index_.sort(*species_);
+
+    chunk_collisions_.assign(std::max<size_t>(cell_index_.n_chunks(), 1), 0);
+    particle::for_each_cell_chunk(
+        cell_index_, streams_, config_.parallel,
+        [this](size_t chunk, size_t begin, size_t end) {
+            chunk_collisions_[chunk] = collide_cells(begin, end);
+        });
+
+    n_collisions_ = 0;
+    for (const size_t n : chunk_collisions_)
+        n_collisions_ += n;
+}
+
+template <unsigned NX, unsigned NV>
+size_t DSMCCollisions<NX, NV>::collide_cells(const size_t begin, const size_t end) {
+    auto* v = species_->v();
+    size_t n_collisions = 0;
+
+    for (size_t cell = begin; cell < end; ++cell) {
+        const auto particles = cell_index_.particles(cell);
+        const size_t n = particles.size();
+        if (n < 2)
+            continue;
+
+        double& sigma_g_max = sigma_g_max_[cell];
+
+        const double n_pairs_f =
+            0.5 * static_cast<double>(n) * static_cast<double>(n - 1) * pair_factor_ * sigma_g_max;
+        auto n_pairs = static_cast<size_t>(n_pairs_f);
+        if (n_pairs_f - static_cast<double>(n_pairs) > random::uniform())
+            ++n_pairs;
+
+        const double acceptance_max = sigma_g_max;
+        const double n_real = static_cast<double>(n);
+
+        for (size_t p = 0; p < n_pairs; ++p) {
+            const auto i = std::min(static_cast<size_t>(random::uniform() * n_real), n - 1);
+            auto j = std::min(static_cast<size_t>(random::uniform() * (n_real - 1.0)), n - 2);
+            if (j >= i)
+                ++j;
+
+            auto& v1 = v[particles[i]];
+            auto& v2 = v[particles[j]];
+            const double g = (v1 - v2).norm();
+            const double sg = sigma_g(g);
+
+            sigma_g_max = std::max(sigma_g_max, sg);
+
+            if (random::uniform() * acceptance_max < sg) {
+                collide_pair(v1, v2);
+                ++n_collisions;
+            }
+        }
+    }
+
+    return n_collisions;
+}
+
+template <unsigned NX, unsigned NV>
+void DSMCCollisions<NX, NV>::collide_pair(core::Vec<NV>& v1, core::Vec<NV>& v2) const {
+    const core::Vec<3> v_cm = 0.5 * (v1 + v2);
+    const core::Vec<3> g = v1 - v2;
+    const double g_mag = g.norm();
+
+    // VSS deflection, isotropic for alpha = 1
+    const double r = random::uniform();
+    const double alpha = config_.model.alpha;
+    const double cos_chi = alpha == 1.0 ? 2.0 * r - 1.0 : 2.0 * std::pow(r, 1.0 / alpha) - 1.0;
+    const double sin_chi = std::sqrt(std::max(0.0, 1.0 - cos_chi * cos_chi));
+    const double eps = 2.0 * constants::pi * random::uniform();
+    const double cos_eps = std::cos(eps);
+    const double sin_eps = std::sin(eps);
+
+    core::Vec<3> g_post;
+    const double g_perp = std::sqrt(g.y * g.y + g.z * g.z);
+    if (g_perp > 1e-12 * g_mag) {
+        g_post = {cos_chi * g.x + sin_chi * sin_eps * g_perp,
+                  cos_chi * g.y + sin_chi * (g_mag * g.z * cos_eps - g.x * g.y * sin_eps) / g_perp,
+                  cos_chi * g.z - sin_chi * (g_mag * g.y * cos_eps + g.x * g.z * sin_eps) / g_perp};
+    } else {
+        g_post = {cos_chi * g_mag, sin_chi * cos_eps * g_mag, sin_chi * sin_eps * g_mag};
+    }
+
+    v1 = v_cm + 0.5 * g_post;
+    v2 = v_cm - 0.5 * g_post;
+}
+
+template class spark::collisions::DSMCCollisions<1, 3>;
+template class spark::collisions::DSMCCollisions<2, 3>;
+template class spark::collisions::DSMCCollisions<3, 3>;
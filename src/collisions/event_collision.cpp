@@ -0,0 +1,151 @@
+#include "spark/collisions/event_collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "log/log.h"
+
+using namespace spark::collisions;
+
+namespace {
+
+double speed(const double kinetic_energy, const double mass) {
+    return std::sqrt(2.0 * spark::constants::e * kinetic_energy / mass);
+}
+
+}  // namespace
+
+template <unsigned NX, unsigned NV>
+EventCollisionSampler<NX, NV>::EventCollisionSampler(
+    particle::ChargedSpecies<NX, NV>* projectile,
+    const std::vector<NullCollisionTarget<NX, NV>>& targets,
+    const EventCollisionConfig<NX, NV>& config)
+    : projectile_(projectile), config_(config) {
+    const bool slow_projectile = config_.dyn == RelativeDynamics::SlowProjectile;
+    mixture_ = MixtureTable<NX, NV>(targets, slow_projectile ? 0.5 : 1.0, config_.table);
+
+    const auto& cs_table = mixture_.table();
+    const size_t n_points = cs_table.n_points();
+    const double e_end = cs_table.energy(n_points - 1);
+    const double e_max = config_.max_energy > e_end ? config_.max_energy : e_end;
+
+    // As for the energy bins of NullCollisionSampler, max(sigma_i, sigma_i+1) * v(E_i+1) bounds
+    // sigma * v on each interval, and the cross sections are constant beyond the table
+    sigma_v_max_.assign(mixture_.n_targets(), 0.0);
+    for (size_t t = 0; t < mixture_.n_targets(); ++t) {
+        for (size_t i = 0; i + 1 < n_points; ++i) {
+            const double sigma_v = std::max(mixture_.total(t, i), mixture_.total(t, i + 1)) *
+                                   speed(cs_table.energy(i + 1), projectile_->m());
+            sigma_v_max_[t] = std::max(sigma_v_max_[t], sigma_v);
+        }
+
+        const double sigma_v = mixture_.total(t, n_points - 1) * speed(e_max, projectile_->m());
+        sigma_v_max_[t] = std::max(sigma_v_max_[t], sigma_v);
+    }
+
+    if (config_.n_buckets == 0) {
+        SPARK_LOG_WARN("%s", "the calendar queue needs at least one bucket, using 1");
+        config_.n_buckets = 1;
+    }
+    buckets_.resize(config_.n_buckets);
+
+    projectile_->enable_collision_times();
+    update_majorant();
+
+    counters_.reactions.assign(cs_table.n_reactions(), 0);
+    counters_.energy_lost.assign(cs_table.n_reactions(), 0.0);
+    if (config_.source_grid) {
+        source_cells_.emplace(*config_.source_grid);
+        counters_.source.assign(source_cells_->n_cells(), 0.0);
+    }
+}
+
+template <unsigned NX, unsigned NV>
+void EventCollisionSampler<NX, NV>::update_majorant() {
+    const size_t n_targets = mixture_.n_targets();
+    target_nu_prime_.resize(n_targets, 0.0);
+
+    // Slow projectiles collide with one target per candidate, so each share must bound its target
+    const bool slow_projectile = config_.dyn == RelativeDynamics::SlowProjectile;
+    std::vector<double> nu(n_targets);
+    double nu_total = 0.0;
+    bool exceeded = false;
+    for (size_t t = 0; t < n_targets; ++t) {
+        nu[t] = mixture_.target(t).dens_max() * sigma_v_max_[t];
+        nu_total += nu[t];
+        exceeded = exceeded || (slow_projectile && nu[t] > target_nu_prime_[t]);
+    }
+
+    if (!exceeded && nu_total <= nu_prime_)
+        return;
+
+    // The schedules drawn from the old majorant would undersample the collisions, and since the
+    // candidates are memoryless they are simply drawn again from the start of the step
+    const bool scheduled = nu_prime_ > 0.0;
+    const double scale = scheduled ? majorant_headroom_ : 1.0;
+    nu_prime_ = 0.0;
+    for (size_t t = 0; t < n_targets; ++t) {
+        target_nu_prime_[t] = scale * nu[t];
+        nu_prime_ += target_nu_prime_[t];
+    }
+
+    auto* times = projectile_->collision_times();
+    std::fill(times, times + projectile_->n(), std::numeric_limits<double>::quiet_NaN());
+    projectile_->mark_reordered();
+}
+
+template <unsigned NX, unsigned NV>
+void EventCollisionSampler<NX, NV>::schedule_changes() {
+    if (projectile_->reordered()) {
+        for (auto& bucket : buckets_)
+            bucket.clear();
+        for (size_t i = 0; i < projectile_->n(); ++i)
+            schedule(i);
+    } else {
+        // An index is logged again each time its particle is replaced
+        changed_.assign(projectile_->changed().begin(), projectile_->changed().end());
+        std::sort(changed_.begin(), changed_.end());
+        changed_.erase(std::unique(changed_.begin(), changed_.end()), changed_.end());
+
+        for (const size_t i : changed_) {
+            if (i < projectile_->n())
+                schedule(i);
+        }
+    }
+
+    projectile_->clear_changes();
+}
+
+template <unsigned NX, unsigned NV>
+void EventCollisionSampler<NX, NV>::schedule(const size_t id) {
+    if (nu_prime_ <= 0.0)
+        return;
+
+    auto& time = projectile_->collision_times()[id];
+    if (std::isnan(time))
+        time = next_time(static_cast<double>(step_));
+
+    bucket_of(time).push_back({id, time});
+}
+
+template <unsigned NX, unsigned NV>
+void EventCollisionSampler<NX, NV>::apply_events() {
+    // Descending, so that the swap with the last particle never moves another particle that is
+    // also marked for removal
+    auto& removed = events_.removed;
+    std::sort(removed.begin(), removed.end());
+    for (auto it = removed.rbegin(); it != removed.rend(); ++it)
+        projectile_->remove(*it);
+
+    for (const auto& creation : events_.created) {
+        creation.species->add(1, [&creation](core::Vec<NV>& v, core::Vec<NX>& x) {
+            x = creation.x;
+            v = creation.v;
+        });
+    }
+}
+
+template class spark::collisions::EventCollisionSampler<1, 3>;
+template class spark::collisions::EventCollisionSampler<2, 3>;
+template class spark::collisions::EventCollisionSampler<3, 3>;
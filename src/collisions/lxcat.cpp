@@ -0,0 +1,533 @@
+#include "spark/collisions/lxcat.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "log/log.h"
+#include "spark/collisions/basic_reactions.h"
+#include "spark/collisions/cross_section_table.h"
+#include "spark/constants/constants.h"
+
+using namespace spark::collisions;
+
+namespace {
+
+// Cache layout: a header, one record per process, the energy and cross section arrays of all
+// processes and finally the species and process strings. All offsets are in bytes from the start
+// of the file and the arrays are 8 byte aligned, so that they can be used in place when mapped.
+constexpr char cache_magic[8] = {'S', 'P', 'K', 'L', 'X', 'C', 'A', 'T'};
+constexpr uint32_t cache_byte_order = 0x01020304;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t n_processes;
+    uint64_t size;
+};
+
+struct CacheRecord {
+    uint32_t type;
+    uint32_t reserved;
+    double mass_ratio;
+    double threshold;
+    uint64_t n_points;
+    uint64_t energy;
+    uint64_t cross_section;
+    uint64_t species;
+    uint64_t species_size;
+    uint64_t process;
+    uint64_t process_size;
+};
+
+struct ParsedProcess {
+    LXCatProcessType type;
+    std::string species;
+    std::string process;
+    double mass_ratio = 0.0;
+    double threshold = 0.0;
+    std::vector<double> energy;
+    std::vector<double> cross_section;
+};
+
+std::string_view trim(std::string_view s) {
+    const auto first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos)
+        return {};
+    const auto last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+// Target of a species line, e.g. "Ar" for "Ar -> Ar*(11.55eV)"
+std::string_view target_of(std::string_view species) {
+    return trim(species.substr(0, species.find("->")));
+}
+
+bool process_type(std::string_view keyword, LXCatProcessType& type) {
+    if (keyword == "ELASTIC")
+        type = LXCatProcessType::Elastic;
+    else if (keyword == "EFFECTIVE")
+        type = LXCatProcessType::Effective;
+    else if (keyword == "EXCITATION")
+        type = LXCatProcessType::Excitation;
+    else if (keyword == "IONIZATION")
+        type = LXCatProcessType::Ionization;
+    else if (keyword == "ATTACHMENT")
+        type = LXCatProcessType::Attachment;
+    else
+        return false;
+    return true;
+}
+
+bool is_separator(std::string_view line) {
+    return line.size() >= 5 && line.substr(0, 5) == "-----";
+}
+
+// Each process starts with its keyword, followed by the species line, a parameter line (mass ratio
+// or threshold, absent for attachment), optional "KEY: value" comment lines and the table between
+// two lines of dashes. Anything outside of these blocks is free text and ignored.
+std::vector<ParsedProcess> parse_processes(std::istream& in) {
+    std::vector<ParsedProcess> processes;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        LXCatProcessType type;
+        if (!process_type(trim(line), type))
+            continue;
+
+        ParsedProcess p;
+        p.type = type;
+
+        if (!std::getline(in, line))
+            break;
+        p.species = trim(line);
+
+        if (type != LXCatProcessType::Attachment) {
+            if (!std::getline(in, line))
+                break;
+            // Excitation parameters may be followed by a statistical weight ratio, only the
+            // first number is used
+            const double parameter = std::strtod(line.c_str(), nullptr);
+            if (type == LXCatProcessType::Elastic || type == LXCatProcessType::Effective)
+                p.mass_ratio = parameter;
+            else
+                p.threshold = parameter;
+        }
+
+        bool table_started = false;
+        while (std::getline(in, line)) {
+            const auto l = trim(line);
+            if (is_separator(l)) {
+                table_started = true;
+                break;
+            }
+            if (l.substr(0, 8) == "PROCESS:")
+                p.process = trim(l.substr(8));
+        }
+
+        if (!table_started)
+            break;
+
+        bool table_closed = false;
+        while (std::getline(in, line)) {
+            if (is_separator(trim(line))) {
+                table_closed = true;
+                break;
+            }
+
+            std::istringstream row(line);
+            double e, cs;
+            if (row >> e >> cs) {
+                p.energy.push_back(e);
+                p.cross_section.push_back(cs);
+            }
+        }
+
+        if (!table_closed) {
+            SPARK_LOG_WARN("unterminated cross section table for \"%s\"", p.species.c_str());
+        }
+
+        if (p.energy.empty()) {
+            SPARK_LOG_WARN("skipping process \"%s\" without cross section data", p.species.c_str());
+            continue;
+        }
+
+        if (!std::is_sorted(p.energy.begin(), p.energy.end())) {
+            SPARK_LOG_WARN("skipping process \"%s\" with unsorted energies", p.species.c_str());
+            continue;
+        }
+
+        processes.push_back(std::move(p));
+    }
+
+    return processes;
+}
+
+constexpr uint64_t align8(uint64_t n) {
+    return (n + 7) & ~uint64_t{7};
+}
+
+std::vector<uint64_t> serialize(const std::vector<ParsedProcess>& processes,
+                                const uint64_t source_size,
+                                const int64_t source_mtime) {
+    uint64_t size = sizeof(CacheHeader) + processes.size() * sizeof(CacheRecord);
+    for (const auto& p : processes)
+        size += 2 * p.energy.size() * sizeof(double);
+    const uint64_t strings_begin = size;
+    for (const auto& p : processes)
+        size += p.species.size() + p.process.size();
+    size = align8(size);
+
+    std::vector<uint64_t> storage(size / sizeof(uint64_t), 0);
+    auto* data = reinterpret_cast<std::byte*>(storage.data());
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = LXCatDatabase::cache_version;
+    header.byte_order = cache_byte_order;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.n_processes = processes.size();
+    header.size = size;
+    std::memcpy(data, &header, sizeof(header));
+
+    uint64_t arrays = sizeof(CacheHeader) + processes.size() * sizeof(CacheRecord);
+    uint64_t strings = strings_begin;
+    for (size_t i = 0; i < processes.size(); ++i) {
+        const auto& p = processes[i];
+        const uint64_t n_bytes = p.energy.size() * sizeof(double);
+
+        CacheRecord record{};
+        record.type = static_cast<uint32_t>(p.type);
+        record.mass_ratio = p.mass_ratio;
+        record.threshold = p.threshold;
+        record.n_points = p.energy.size();
+        record.energy = arrays;
+        record.cross_section = arrays + n_bytes;
+        record.species = strings;
+        record.species_size = p.species.size();
+        record.process = strings + p.species.size();
+        record.process_size = p.process.size();
+
+        std::memcpy(data + record.energy, p.energy.data(), n_bytes);
+        std::memcpy(data + record.cross_section, p.cross_section.data(), n_bytes);
+        std::memcpy(data + record.species, p.species.data(), p.species.size());
+        std::memcpy(data + record.process, p.process.data(), p.process.size());
+        std::memcpy(data + sizeof(CacheHeader) + i * sizeof(CacheRecord), &record, sizeof(record));
+
+        arrays += 2 * n_bytes;
+        strings += p.species.size() + p.process.size();
+    }
+
+    return storage;
+}
+
+bool source_stamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+
+    size = file_size;
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+}  // namespace
+
+LXCatDatabase::LXCatDatabase(LXCatDatabase&& other) noexcept {
+    *this = std::move(other);
+}
+
+LXCatDatabase& LXCatDatabase::operator=(LXCatDatabase&& other) noexcept {
+    if (this != &other) {
+        release();
+        // Moving the vectors keeps their buffers, so the views stay valid
+        processes_ = std::move(other.processes_);
+        storage_ = std::move(other.storage_);
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        source_size_ = other.source_size_;
+        source_mtime_ = other.source_mtime_;
+        other.processes_.clear();
+    }
+    return *this;
+}
+
+LXCatDatabase::~LXCatDatabase() {
+    release();
+}
+
+void LXCatDatabase::release() {
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    storage_.clear();
+    processes_.clear();
+}
+
+LXCatDatabase LXCatDatabase::from_storage(std::vector<uint64_t>&& storage) {
+    LXCatDatabase database;
+    database.storage_ = std::move(storage);
+    database.read_layout(reinterpret_cast<const std::byte*>(database.storage_.data()),
+                         database.storage_.size() * sizeof(uint64_t));
+    return database;
+}
+
+bool LXCatDatabase::read_layout(const std::byte* data, const size_t size) {
+    processes_.clear();
+
+    CacheHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version || header.byte_order != cache_byte_order ||
+        header.size != size ||
+        header.n_processes > (size - sizeof(header)) / sizeof(CacheRecord))
+        return false;
+
+    const auto in_bounds = [&](uint64_t offset, uint64_t n_bytes) {
+        return offset <= size && n_bytes <= size - offset;
+    };
+
+    std::vector<LXCatProcess> processes(header.n_processes);
+    for (size_t i = 0; i < header.n_processes; ++i) {
+        CacheRecord r;
+        std::memcpy(&r, data + sizeof(header) + i * sizeof(CacheRecord), sizeof(r));
+
+        const uint64_t n_bytes = r.n_points * sizeof(double);
+        if (r.type > static_cast<uint32_t>(LXCatProcessType::Attachment) ||
+            r.n_points > size / sizeof(double) || r.energy % 8 != 0 || r.cross_section % 8 != 0 ||
+            !in_bounds(r.energy, n_bytes) || !in_bounds(r.cross_section, n_bytes) ||
+            !in_bounds(r.species, r.species_size) || !in_bounds(r.process, r.process_size))
+            return false;
+
+        auto& p = processes[i];
+        p.type = static_cast<LXCatProcessType>(r.type);
+        p.species = {reinterpret_cast<const char*>(data + r.species), r.species_size};
+        p.process = {reinterpret_cast<const char*>(data + r.process), r.process_size};
+        p.mass_ratio = r.mass_ratio;
+        p.threshold = r.threshold;
+        p.energy = {reinterpret_cast<const double*>(data + r.energy), r.n_points};
+        p.cross_section = {reinterpret_cast<const double*>(data + r.cross_section), r.n_points};
+    }
+
+    processes_ = std::move(processes);
+    source_size_ = header.source_size;
+    source_mtime_ = header.source_mtime;
+    return true;
+}
+
+LXCatDatabase LXCatDatabase::parse(std::istream& in) {
+    return from_storage(serialize(parse_processes(in), 0, 0));
+}
+
+LXCatDatabase LXCatDatabase::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        SPARK_LOG_ERROR("could not open LXCat file \"%s\"", path.c_str());
+        return {};
+    }
+
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    source_stamp(path, size, mtime);
+
+    return from_storage(serialize(parse_processes(in), size, mtime));
+}
+
+bool LXCatDatabase::map(const std::string& cache_path) {
+    const int fd = ::open(cache_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CacheHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    if (!read_layout(static_cast<const std::byte*>(data), size)) {
+        munmap(data, size);
+        return false;
+    }
+
+    map_ = data;
+    map_size_ = size;
+    return true;
+}
+
+LXCatDatabase LXCatDatabase::load_cached(const std::string& path, const std::string& cache_path) {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    const bool has_source = source_stamp(path, size, mtime);
+
+    LXCatDatabase database;
+    if (database.map(cache_path)) {
+        // Without the text file the cache is used as is
+        if (!has_source || (database.source_size_ == size && database.source_mtime_ == mtime))
+            return database;
+        database.release();
+    }
+
+    database = load(path);
+    if (database.empty())
+        return database;
+
+    if (!database.write_cache(cache_path))
+        return database;
+
+    LXCatDatabase cached;
+    if (cached.map(cache_path))
+        return cached;
+
+    return database;
+}
+
+bool LXCatDatabase::write_cache(const std::string& cache_path) const {
+    const void* data = map_ ? map_ : static_cast<const void*>(storage_.data());
+    const size_t size = map_ ? map_size_ : storage_.size() * sizeof(uint64_t);
+    if (size == 0)
+        return false;
+
+    // Written under a unique name and renamed, so readers never see a partial file
+    const std::string tmp_path = cache_path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!out) {
+            SPARK_LOG_WARN("could not write cross section cache \"%s\"", tmp_path.c_str());
+            std::error_code ec;
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, cache_path, ec);
+    if (ec) {
+        SPARK_LOG_WARN("could not replace cross section cache \"%s\"", cache_path.c_str());
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+
+    return true;
+}
+
+template <unsigned NX, unsigned NV>
+Reactions<NX, NV> spark::collisions::make_electron_reactions(
+    const LXCatDatabase& database,
+    const LXCatReactionsConfig<NX, NV>& config) {
+    using namespace reactions;
+
+    std::vector<const LXCatProcess*> processes;
+    for (const auto& p : database.processes()) {
+        if (p.species.substr(0, config.target.size()) == config.target)
+            processes.push_back(&p);
+    }
+
+    double target_mass = config.target_mass;
+    for (const auto* p : processes) {
+        const bool elastic =
+            p->type == LXCatProcessType::Elastic || p->type == LXCatProcessType::Effective;
+        if (target_mass <= 0.0 && elastic && p->mass_ratio > 0.0)
+            target_mass = constants::m_e / p->mass_ratio;
+    }
+
+    if (target_mass <= 0.0) {
+        SPARK_LOG_WARN("%s", "no target mass given or found in the LXCat processes");
+    }
+
+    const auto simulated_inelastic = [&](const LXCatProcess& p) {
+        return p.type == LXCatProcessType::Excitation || p.type == LXCatProcessType::Attachment ||
+               (p.type == LXCatProcessType::Ionization && config.ions);
+    };
+
+    // An effective cross section is the total momentum transfer cross section, which already
+    // includes the inelastic processes. As in BOLSIG+, the elastic collision uses what remains
+    // after subtracting the simulated inelastic processes of the same target, interpolated on the
+    // effective grid and clamped at 0, so that they are not counted twice.
+    const auto elastic_part = [&](const LXCatProcess& effective) {
+        auto cs = effective.to_cross_section();
+        const auto target = target_of(effective.species);
+        for (const auto* p : processes) {
+            if (!simulated_inelastic(*p) || target_of(p->species) != target)
+                continue;
+            const auto inelastic = p->to_cross_section();
+            for (size_t i = 0; i < cs.energy.size(); ++i)
+                cs.cross_section[i] -= interpolate_cross_section(inelastic, cs.energy[i]);
+        }
+        for (auto& sigma : cs.cross_section)
+            sigma = std::max(sigma, 0.0);
+        return cs;
+    };
+
+    const BasicCollisionConfig basic_config{target_mass};
+
+    Reactions<NX, NV> reactions;
+    for (const auto* p : processes) {
+        switch (p->type) {
+            case LXCatProcessType::Elastic:
+                reactions.push_back(std::make_unique<ElectronElasticCollision<NX, NV>>(
+                    basic_config, p->to_cross_section()));
+                break;
+            case LXCatProcessType::Effective:
+                reactions.push_back(std::make_unique<ElectronElasticCollision<NX, NV>>(
+                    basic_config, elastic_part(*p)));
+                break;
+            case LXCatProcessType::Excitation:
+                reactions.push_back(std::make_unique<ExcitationCollision<NX, NV>>(
+                    basic_config, p->to_cross_section()));
+                break;
+            case LXCatProcessType::Ionization:
+                if (!config.ions) {
+                    SPARK_LOG_WARN("skipping ionization \"%.*s\" without an ion species",
+                                   static_cast<int>(p->species.size()), p->species.data());
+                    break;
+                }
+                reactions.push_back(std::make_unique<IonizationCollision<NX, NV>>(
+                    config.ions, config.t_neutral, basic_config, p->to_cross_section()));
+                break;
+            case LXCatProcessType::Attachment:
+                reactions.push_back(
+                    std::make_unique<SinkCollision<NX, NV>>(basic_config, p->to_cross_section()));
+                break;
+        }
+    }
+
+    return reactions;
+}
+
+template spark::collisions::Reactions<1, 3> spark::collisions::make_electron_reactions(
+    const LXCatDatabase&,
+    const LXCatReactionsConfig<1, 3>&);
+template spark::collisions::Reactions<2, 3> spark::collisions::make_electron_reactions(
+    const LXCatDatabase&,
+    const LXCatReactionsConfig<2, 3>&);
+template spark::collisions::Reactions<3, 3> spark::collisions::make_electron_reactions(
+    const LXCatDatabase&,
+    const LXCatReactionsConfig<3, 3>&);
@@ -0,0 +1,470 @@
+#include "spark/collisions/null_collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "log/log.h"
+#include "spark/constants/constants.h"
+#include "spark/particle/species.h"
+#include "spark/random/random.h"
+
+using namespace spark::collisions;
+
+namespace {
+
+// Selects n distinct indices in [0, range) in increasing order using Vitter's method D, which
+// draws O(n) random numbers and falls back to method A when n is a large fraction of the range
+// (J. S. Vitter, ACM Trans. Math. Softw. 13, 58 (1987))
+void sample_sorted(size_t n, const size_t range, std::vector<size_t>& out) {
+    out.clear();
+    if (n >= range) {
+        for (size_t i = 0; i < range; ++i)
+            out.push_back(i);
+        return;
+    }
+
+    if (n == 0)
+        return;
+
+    constexpr double neg_alpha_inv = -13.0;
+
+    size_t pos = 0;
+    const auto select_after = [&](const size_t skip) {
+        pos += skip;
+        out.push_back(pos++);
+    };
+
+    double n_real = static_cast<double>(n);
+    double range_real = static_cast<double>(range);
+    double n_inv = 1.0 / n_real;
+    double qu1_real = range_real - n_real + 1.0;
+    double v_prime = std::exp(std::log(spark::random::uniform()) * n_inv);
+    double threshold = -neg_alpha_inv * n_real;
+
+    while (n > 1 && threshold < range_real) {
+        const double n_min1_inv = 1.0 / (n_real - 1.0);
+        double s;
+
+        while (true) {
+            double x;
+            while (true) {
+                x = range_real * (1.0 - v_prime);
+                s = std::floor(x);
+                if (s < qu1_real)
+                    break;
+                v_prime = std::exp(std::log(spark::random::uniform()) * n_inv);
+            }
+
+            const double u = spark::random::uniform();
+            const double y1 = std::exp(std::log(u * range_real / qu1_real) * n_min1_inv);
+            v_prime = y1 * (1.0 - x / range_real) * (qu1_real / (qu1_real - s));
+            if (v_prime <= 1.0)
+                break;
+
+            double y2 = 1.0;
+            double top = range_real - 1.0;
+            double bottom, limit;
+            if (n_real - 1.0 > s) {
+                bottom = range_real - n_real;
+                limit = range_real - s;
+            } else {
+                bottom = range_real - s - 1.0;
+                limit = qu1_real;
+            }
+
+            for (double t = range_real - 1.0; t >= limit; t -= 1.0) {
+                y2 = (y2 * top) / bottom;
+                top -= 1.0;
+                bottom -= 1.0;
+            }
+
+            if (range_real / (range_real - x) >= y1 * std::exp(std::log(y2) * n_min1_inv)) {
+                v_prime = std::exp(std::log(spark::random::uniform()) * n_min1_inv);
+                break;
+            }
+
+            v_prime = std::exp(std::log(spark::random::uniform()) * n_inv);
+        }
+
+        select_after(static_cast<size_t>(s));
+
+        range_real -= s + 1.0;
+        n_real -= 1.0;
+        --n;
+        n_inv = n_min1_inv;
+        qu1_real -= s;
+        threshold += neg_alpha_inv;
+    }
+
+    if (n > 1) {
+        // Method A for the remaining samples
+        double top = range_real - n_real;
+        while (n > 1) {
+            const double v = spark::random::uniform();
+            size_t skip = 0;
+            double quot = top / range_real;
+            while (quot > v) {
+                ++skip;
+                top -= 1.0;
+                range_real -= 1.0;
+                quot *= top / range_real;
+            }
+
+            select_after(skip);
+            range_real -= 1.0;
+            --n;
+        }
+
+        select_after(static_cast<size_t>(
+            std::min(std::floor(range_real * spark::random::uniform()), range_real - 1.0)));
+        return;
+    }
+
+    select_after(static_cast<size_t>(std::min(std::floor(range_real * v_prime), range_real - 1.0)));
+}
+
+double calc_p_null(const double nu_prime, const double dt) {
+    return 1.0 - std::exp(-nu_prime * dt);
+}
+
+size_t calc_n_null(const double nu_prime, const double dt, const size_t n) {
+    const double n_null_f = calc_p_null(nu_prime, dt) * static_cast<double>(n);
+    auto n_null = static_cast<size_t>(std::floor(n_null_f));
+    return n_null_f - static_cast<double>(n_null) > spark::random::uniform() ? n_null + 1 : n_null;
+}
+
+double speed(const double kinetic_energy, const double mass) {
+    return std::sqrt(2.0 * spark::constants::e * kinetic_energy / mass);
+}
+
+template <typename T, unsigned NX>
+std::array<T, 3> to_array3(const spark::core::TVec<T, NX>& v, const T fill) {
+    std::array<T, 3> a = {v.x, fill, fill};
+    if constexpr (NX > 1)
+        a[1] = v.y;
+    if constexpr (NX > 2)
+        a[2] = v.z;
+    return a;
+}
+
+}  // namespace
+
+template <unsigned NX, unsigned NV>
+MixtureTable<NX, NV>::MixtureTable(const std::vector<NullCollisionTarget<NX, NV>>& targets,
+                                   const double energy_scale,
+                                   const CrossSectionTableConfig& config) {
+    std::vector<const CrossSection*> cross_sections;
+    offsets_.push_back(0);
+    for (const auto& target : targets) {
+        if (target.cross_sections.empty()) {
+            SPARK_LOG_WARN("%s", "ignoring a target without reactions");
+            continue;
+        }
+
+        targets_.push_back(target.target);
+        cross_sections.insert(cross_sections.end(), target.cross_sections.begin(),
+                              target.cross_sections.end());
+        offsets_.push_back(cross_sections.size());
+    }
+
+    table_ = CrossSectionTable(cross_sections, energy_scale, config);
+}
+
+template <unsigned NX, unsigned NV>
+NullCollisionSampler<NX, NV>::NullCollisionSampler(
+    particle::ChargedSpecies<NX, NV>* projectile,
+    const std::vector<NullCollisionTarget<NX, NV>>& targets,
+    const NullCollisionConfig<NX, NV>& config)
+    : projectile_(projectile), config_(config), streams_(random::uniform_u64()) {
+    const bool slow_projectile = config_.dyn == RelativeDynamics::SlowProjectile;
+
+    mixture_ = MixtureTable<NX, NV>(targets, slow_projectile ? 0.5 : 1.0, config_.table);
+    const auto& cs_table = mixture_.table();
+    const size_t n_targets = mixture_.n_targets();
+
+    if (config_.n_energy_bins > 1 && slow_projectile) {
+        SPARK_LOG_WARN("%s", "energy binned majorants are not supported for slow projectiles");
+    } else if (config_.n_energy_bins > 1) {
+        n_energy_bins_ = std::min(config_.n_energy_bins, cs_table.n_points() - 1);
+    }
+
+    // The cross sections are linear between grid points and the speed increases with energy, so
+    // max(sigma_i, sigma_i+1) * v(E_i+1) bounds sigma * v on each interval. With a single bin,
+    // energies beyond the end of the table are not covered by the majorant.
+    const size_t n_intervals = cs_table.n_points() - 1;
+    energy_bin_sigma_v_.assign(n_targets * n_energy_bins_, 0.0);
+    for (size_t t = 0; t < n_targets; ++t) {
+        for (size_t i = 0; i < n_intervals; ++i) {
+            const size_t bin = t * n_energy_bins_ + i * n_energy_bins_ / n_intervals;
+            const double sigma_v = std::max(mixture_.total(t, i), mixture_.total(t, i + 1)) *
+                                   speed(cs_table.energy(i + 1), projectile_->m());
+            energy_bin_sigma_v_[bin] = std::max(energy_bin_sigma_v_[bin], sigma_v);
+        }
+    }
+
+    // The tiles follow the grid of the first target that has one
+    const spatial::UniformGrid<NX>* tile_grid = nullptr;
+    for (size_t t = 0; t < n_targets && !tile_grid; ++t)
+        tile_grid = mixture_.target(t).density_grid();
+
+    if (config_.majorant_tile_size > 0) {
+        if (const auto* grid = tile_grid) {
+            const auto n_nodes = to_array3(grid->n(), size_t{2});
+            const auto dx = to_array3(grid->dx(), 1.0);
+            n_tiles_ = 1;
+            for (size_t d = 0; d < 3; ++d) {
+                n_cells_[d] = n_nodes[d] - 1;
+                n_tiles_dim_[d] =
+                    (n_cells_[d] + config_.majorant_tile_size - 1) / config_.majorant_tile_size;
+                inv_dx_[d] = 1.0 / dx[d];
+                n_tiles_ *= n_tiles_dim_[d];
+            }
+
+            update_tile_majorants();
+        } else {
+            SPARK_LOG_WARN("%s", "local majorants require a target with a density grid");
+        }
+    }
+
+    n_bins_ = n_tiles_ * n_energy_bins_;
+    bin_nu_prime_.resize(n_bins_);
+    if (slow_projectile)
+        target_nu_prime_.resize(n_bins_ * n_targets);
+
+    if (config_.source_grid)
+        source_cells_.emplace(*config_.source_grid);
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::update_tile_majorants() {
+    tile_dens_max_.resize(mixture_.n_targets() * n_tiles_);
+    for (size_t t = 0; t < mixture_.n_targets(); ++t)
+        update_tile_majorants(t, tile_dens_max_.data() + t * n_tiles_);
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::update_tile_majorants(const size_t target, double* tile_max) {
+    auto& gas = mixture_.target(target);
+    const auto* grid = gas.density_grid();
+
+    // Targets without a grid matching the tiles are bounded by their global maximum
+    bool matching = grid != nullptr;
+    if (matching) {
+        const auto n_nodes = to_array3(grid->n(), size_t{2});
+        for (size_t d = 0; d < 3; ++d)
+            matching = matching && n_nodes[d] - 1 == n_cells_[d];
+    }
+
+    if (!matching) {
+        std::fill(tile_max, tile_max + n_tiles_, gas.dens_max());
+        return;
+    }
+
+    const auto& data = grid->data().data();
+    const auto n_nodes = to_array3(grid->n(), size_t{1});
+    const size_t ts = config_.majorant_tile_size;
+
+    // The density inside a cell is interpolated from its corner nodes, so each tile is bounded by
+    // the nodes of its cells, including those it shares with its neighbours. The bounds are
+    // rebuilt from scratch, so that they also drop when the density of a varying target
+    // decreases.
+    //
+    // The nodes that changed are not tracked: the density of a varying target is usually deposited
+    // anew each step, which rewrites every node anyway. Reading the nodes tile by tile, along the
+    // last axis, a pass costs about as much as clearing the grid and its dens_max(), e.g. 3.3 ms
+    // against 2.7 ms for 1025 x 1025 nodes and tiles of 8 cells.
+    std::array<size_t, 3> lo, hi;
+    for (size_t ti = 0; ti < n_tiles_dim_[0]; ++ti) {
+        for (size_t tj = 0; tj < n_tiles_dim_[1]; ++tj) {
+            for (size_t tk = 0; tk < n_tiles_dim_[2]; ++tk) {
+                const std::array<size_t, 3> t = {ti, tj, tk};
+                for (size_t d = 0; d < 3; ++d) {
+                    lo[d] = t[d] * ts;
+                    hi[d] = std::min({(t[d] + 1) * ts, n_cells_[d], n_nodes[d] - 1});
+                }
+
+                double dens = 0.0;
+                for (size_t i = lo[0]; i <= hi[0]; ++i)
+                    for (size_t j = lo[1]; j <= hi[1]; ++j) {
+                        const double* row = &data[(i * n_nodes[1] + j) * n_nodes[2]];
+                        for (size_t k = lo[2]; k <= hi[2]; ++k)
+                            dens = std::max(dens, row[k]);
+                    }
+
+                tile_max[(ti * n_tiles_dim_[1] + tj) * n_tiles_dim_[2] + tk] = dens;
+            }
+        }
+    }
+}
+
+template <unsigned NX, unsigned NV>
+size_t NullCollisionSampler<NX, NV>::tile_of(const core::Vec<NX>& x) const {
+    const auto pos = to_array3(x, 0.0);
+    size_t tile = 0;
+    for (size_t d = 0; d < 3; ++d) {
+        const double cell_f = std::floor(pos[d] * inv_dx_[d]);
+        const size_t cell =
+            cell_f <= 0.0 ? 0 : std::min(static_cast<size_t>(cell_f), n_cells_[d] - 1);
+        tile = tile * n_tiles_dim_[d] + cell / config_.majorant_tile_size;
+    }
+    return tile;
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::sample_bins() {
+    const auto& cs_table = mixture_.table();
+    const size_t n = projectile_->n();
+    const size_t n_intervals = cs_table.n_points() - 1;
+    const size_t last_energy_bin = n_energy_bins_ - 1;
+
+    particle_bin_.resize(n);
+    bin_offsets_.assign(n_bins_ + 1, 0);
+    tile_max_energy_.assign(n_tiles_, 0.0);
+
+    for (size_t i = 0; i < n; ++i) {
+        const size_t tile = n_tiles_ > 1 ? tile_of(projectile_->x()[i]) : 0;
+        size_t energy_bin = 0;
+
+        if (n_energy_bins_ > 1) {
+            const double energy = kinetic_energy(i);
+            // Binned by grid interval so that the bin matches the one whose majorant covers it
+            const auto interval =
+                std::min(static_cast<size_t>(cs_table.index(energy)), n_intervals - 1);
+            energy_bin = interval * n_energy_bins_ / n_intervals;
+
+            if (energy_bin == last_energy_bin)
+                tile_max_energy_[tile] = std::max(tile_max_energy_[tile], energy);
+        }
+
+        const size_t bin = tile * n_energy_bins_ + energy_bin;
+        particle_bin_[i] = static_cast<uint32_t>(bin);
+        bin_offsets_[bin + 1]++;
+    }
+
+    for (size_t b = 0; b < n_bins_; ++b)
+        bin_offsets_[b + 1] += bin_offsets_[b];
+
+    // Counting sort, which keeps the particles of each bin in increasing order
+    bin_particles_.resize(n);
+    bin_samples_.assign(bin_offsets_.begin(), bin_offsets_.end() - 1);
+    for (size_t i = 0; i < n; ++i)
+        bin_particles_[bin_samples_[particle_bin_[i]]++] = i;
+
+    const size_t n_targets = mixture_.n_targets();
+    for (size_t tile = 0; tile < n_tiles_; ++tile) {
+        const auto dens = [&](const size_t t) {
+            return n_tiles_ > 1 ? tile_dens_max_[t * n_tiles_ + tile]
+                                : mixture_.target(t).dens_max();
+        };
+
+        for (size_t e = 0; e < n_energy_bins_; ++e) {
+            const size_t bin = tile * n_energy_bins_ + e;
+            double nu_prime = 0.0;
+            for (size_t t = 0; t < n_targets; ++t) {
+                const double share = dens(t) * energy_bin_sigma_v_[t * n_energy_bins_ + e];
+                if (!target_nu_prime_.empty())
+                    target_nu_prime_[bin * n_targets + t] = share;
+                nu_prime += share;
+            }
+            bin_nu_prime_[bin] = nu_prime;
+        }
+
+        // The cross sections are constant beyond the end of the table while the speed keeps
+        // growing
+        if (n_energy_bins_ > 1) {
+            const double e_max = tile_max_energy_[tile];
+            const auto point = cs_table.at(e_max);
+            double nu = 0.0;
+            for (size_t t = 0; t < n_targets; ++t)
+                nu += dens(t) * mixture_.total(t, point);
+
+            auto& nu_prime = bin_nu_prime_[tile * n_energy_bins_ + last_energy_bin];
+            nu_prime = std::max(nu_prime, nu * speed(e_max, projectile_->m()));
+        }
+    }
+
+    particle_samples_.clear();
+    for (size_t b = 0; b < n_bins_; ++b) {
+        const size_t offset = bin_offsets_[b];
+        const size_t count = bin_offsets_[b + 1] - offset;
+
+        sample_sorted(calc_n_null(bin_nu_prime_[b], config_.dt, count), count, bin_samples_);
+        for (const size_t j : bin_samples_)
+            particle_samples_.push_back(bin_particles_[offset + j]);
+    }
+
+    std::sort(particle_samples_.begin(), particle_samples_.end());
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::sample() {
+    if (n_tiles_ > 1) {
+        for (size_t t = 0; t < mixture_.n_targets(); ++t) {
+            if (mixture_.target(t).varying())
+                update_tile_majorants(t, tile_dens_max_.data() + t * n_tiles_);
+        }
+    }
+
+    // Sorted samples so that particles are visited in memory order
+    if (n_bins_ > 1) {
+        sample_bins();
+    } else {
+        bin_nu_prime_[0] = 0.0;
+        for (size_t t = 0; t < mixture_.n_targets(); ++t) {
+            const double share = mixture_.target(t).dens_max() * energy_bin_sigma_v_[t];
+            if (!target_nu_prime_.empty())
+                target_nu_prime_[t] = share;
+            bin_nu_prime_[0] += share;
+        }
+        const size_t n = projectile_->n();
+        sample_sorted(calc_n_null(bin_nu_prime_[0], config_.dt, n), n, particle_samples_);
+    }
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::apply_events(const size_t n_chunks) {
+    // Chunks cover increasing sample ranges, so the removals are merged in ascending order. They
+    // are applied in descending order so that the swap with the last particle never moves another
+    // particle that is also marked for removal.
+    for (size_t c = n_chunks; c-- > 0;) {
+        const auto& removed = events_[c].removed;
+        for (auto it = removed.rbegin(); it != removed.rend(); ++it)
+            projectile_->remove(*it);
+    }
+
+    for (size_t c = 0; c < n_chunks; ++c) {
+        for (const auto& creation : events_[c].created) {
+            creation.species->add(1, [&creation](core::Vec<NV>& v, core::Vec<NX>& x) {
+                x = creation.x;
+                v = creation.v;
+            });
+        }
+    }
+}
+
+template <unsigned NX, unsigned NV>
+MCCCounters NullCollisionSampler<NX, NV>::counters() const {
+    MCCCounters total;
+    total.reactions.assign(table().n_reactions(), 0);
+    total.energy_lost.assign(table().n_reactions(), 0.0);
+    total.source.assign(source_cells_ ? source_cells_->n_cells() : 0, 0.0);
+
+    for (const auto& counters : chunk_counters_)
+        total.merge(counters);
+
+    return total;
+}
+
+template <unsigned NX, unsigned NV>
+void NullCollisionSampler<NX, NV>::reset_counters() {
+    for (auto& counters : chunk_counters_)
+        counters.clear();
+}
+
+template class spark::collisions::MixtureTable<1, 3>;
+template class spark::collisions::MixtureTable<2, 3>;
+template class spark::collisions::MixtureTable<3, 3>;
+
+template class spark::collisions::NullCollisionSampler<1, 3>;
+template class spark::collisions::NullCollisionSampler<2, 3>;
+template class spark::collisions::NullCollisionSampler<3, 3>;
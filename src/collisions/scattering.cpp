@@ -1,5 +1,6 @@
 #include "spark/collisions/scattering.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "spark/constants/constants.h"
@@ -15,6 +16,14 @@ double scattering::random_chi2() {
     return std::acos(sqrt(1.0 - spark::random::uniform()));
 }
 
+spark::core::Vec<3> scattering::isotropic_direction() {
+    const double cos_theta = 1.0 - 2.0 * spark::random::uniform();
+    const double sin_theta = std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta));
+    double cos_phi, sin_phi;
+    sincos_2pi(spark::random::uniform(), cos_phi, sin_phi);
+    return {sin_theta * cos_phi, sin_theta * sin_phi, cos_theta};
+}
+
 spark::core::Vec<3> scattering::isotropic_scatter(const spark::core::Vec<3>& v, double chi) {
     const auto [x, y, z] = v.normalized();
 
@@ -30,6 +39,75 @@ spark::core::Vec<3> scattering::isotropic_scatter(const spark::core::Vec<3>& v,
             z * k0 - (x * x + y * y) * k3};
 }
 
+void scattering::ScatteringBatch::apply(spark::core::Vec<3>* v) {
+    const size_t n = ids_.size();
+    uniforms_.resize(2 * std::min(n, block_size_));
+    v_block_.resize(std::min(n, block_size_));
+
+    for (size_t begin = 0; begin < n; begin += block_size_) {
+        const size_t m = std::min(block_size_, n - begin);
+        const size_t* ids = ids_.data() + begin;
+        const ScatteringKind* kinds = kinds_.data() + begin;
+        const double* v_mag = v_mag_.data() + begin;
+        const double* param = param_.data() + begin;
+        double* u_chi = uniforms_.data();
+        double* u_phi = uniforms_.data() + m;
+        auto* vb = v_block_.data();
+
+        spark::random::fill_uniform({uniforms_.data(), 2 * m});
+
+        for (size_t i = 0; i < m; ++i)
+            vb[i] = v[ids[i]];
+
+#pragma omp simd
+        for (size_t i = 0; i < m; ++i) {
+            const double u = u_chi[i];
+            const bool equal_mass = kinds[i] == ScatteringKind::EqualMassElastic;
+            const bool given = kinds[i] == ScatteringKind::GivenAngle;
+
+            // Isotropic: cos chi = 1 - 2u, sin chi = 2 sqrt(u (1 - u))
+            // Equal mass: cos chi = sqrt(1 - u), sin chi = sqrt(u)
+            // Given: cos chi = param, sin chi = sqrt(1 - param^2)
+            double cos_chi = equal_mass ? std::sqrt(1.0 - u) : 1.0 - 2.0 * u;
+            double one_minus_cos = equal_mass ? 1.0 - cos_chi : 2.0 * u;
+            double sin_chi =
+                equal_mass ? std::sqrt(u) : 2.0 * std::sqrt(std::max(0.0, u * (1.0 - u)));
+            if (given) {
+                cos_chi = param[i];
+                one_minus_cos = 1.0 - cos_chi;
+                sin_chi = std::sqrt(std::max(0.0, 1.0 - cos_chi * cos_chi));
+            }
+
+            double speed = v_mag[i];
+            if (kinds[i] == ScatteringKind::IsotropicElastic)
+                speed *= std::sqrt(std::max(0.0, 1.0 - param[i] * one_minus_cos));
+            else if (equal_mass)
+                speed *= cos_chi;
+
+            double cos_phi, sin_phi;
+            sincos_2pi(u_phi[i], cos_phi, sin_phi);
+
+            // Particles at rest are deflected from the z axis
+            const auto& w = vb[i];
+            const double norm = std::sqrt(w.x * w.x + w.y * w.y + w.z * w.z);
+            const double inv_norm = norm > 0.0 ? 1.0 / norm : 0.0;
+            const spark::core::Vec<3> dir = {w.x * inv_norm, w.y * inv_norm,
+                                             norm > 0.0 ? w.z * inv_norm : 1.0};
+
+            const auto d = rotation_delta(dir, one_minus_cos, sin_chi, cos_phi, sin_phi);
+            vb[i] = {(dir.x + d.x) * speed, (dir.y + d.y) * speed, (dir.z + d.z) * speed};
+        }
+
+        for (size_t i = 0; i < m; ++i)
+            v[ids[i]] = vb[i];
+    }
+
+    for (const auto& replacement : replaced_)
+        v[replacement.id] = replacement.v;
+
+    clear();
+}
+
 template <unsigned NX>
 void scattering::isotropic_coll(particle::ChargedSpecies<NX, 3>& species,
                                 size_t idx,
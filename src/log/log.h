@@ -45,7 +45,7 @@
         printf(LOG_COLOR_RED "[spark-error] " msg LOG_COLOR_RESET LOG_END_LINE, __VA_ARGS__); \
     }
 #else
-SPARK_LOG_ERROR(msg, ...)
+#define SPARK_LOG_ERROR(msg, ...)
 #endif
 
 #endif  // LOG_H
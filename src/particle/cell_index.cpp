@@ -0,0 +1,114 @@
+#include "spark/particle/cell_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace spark::particle;
+
+namespace {
+
+template <unsigned NX>
+std::array<double, NX> to_array(const spark::core::Vec<NX>& v) {
+    if constexpr (NX == 1)
+        return {v.x};
+    else if constexpr (NX == 2)
+        return {v.x, v.y};
+    else
+        return {v.x, v.y, v.z};
+}
+
+}  // namespace
+
+template <unsigned NX, unsigned NV>
+CellIndex<NX, NV>::CellIndex(const spatial::GridProp<NX>& grid) {
+    const auto dx = to_array<NX>(grid.dx);
+    const auto n = to_array<NX>(grid.n.template to<double>());
+
+    n_cells_total_ = 1;
+    cell_volume_ = 1.0;
+    for (size_t d = 0; d < NX; ++d) {
+        n_cells_[d] = n[d] > 1.0 ? static_cast<size_t>(n[d]) - 1 : 1;
+        inv_dx_[d] = 1.0 / dx[d];
+        n_cells_total_ *= n_cells_[d];
+        cell_volume_ *= dx[d];
+    }
+
+    offsets_.assign(n_cells_total_ + 1, 0);
+}
+
+template <unsigned NX, unsigned NV>
+size_t CellIndex<NX, NV>::cell_of(const core::Vec<NX>& x) const {
+    const auto pos = to_array<NX>(x);
+    size_t cell = 0;
+    for (size_t d = 0; d < NX; ++d) {
+        const double c = std::floor(pos[d] * inv_dx_[d]);
+        const size_t i = c <= 0.0 ? 0 : std::min(static_cast<size_t>(c), n_cells_[d] - 1);
+        cell = cell * n_cells_[d] + i;
+    }
+    return cell;
+}
+
+template <unsigned NX, unsigned NV>
+void CellIndex<NX, NV>::update(const Species<NX, NV>& species) {
+    const size_t n = species.n();
+    const auto* x = species.x();
+
+    cells_.resize(n);
+    offsets_.assign(n_cells_total_ + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        cells_[i] = cell_of(x[i]);
+        offsets_[cells_[i] + 1]++;
+    }
+
+    for (size_t c = 0; c < n_cells_total_; ++c)
+        offsets_[c + 1] += offsets_[c];
+
+    particles_.resize(n);
+    std::vector<size_t>& next = cells_;
+    // The cell of each particle is only needed once, so it is replaced by its slot in place
+    for (size_t i = 0; i < n; ++i)
+        next[i] = offsets_[cells_[i]]++;
+
+    for (size_t c = n_cells_total_; c > 0; --c)
+        offsets_[c] = offsets_[c - 1];
+    offsets_[0] = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        particles_[next[i]] = i;
+}
+
+template <unsigned NX, unsigned NV>
+void CellIndex<NX, NV>::sort(Species<NX, NV>& species) {
+    update(species);
+
+    const size_t n = species.n();
+    auto* x = species.x();
+    auto* v = species.v();
+
+    x_buffer_.resize(n);
+    v_buffer_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        x_buffer_[i] = x[particles_[i]];
+        v_buffer_[i] = v[particles_[i]];
+    }
+
+    std::copy(x_buffer_.begin(), x_buffer_.end(), x);
+    std::copy(v_buffer_.begin(), v_buffer_.end(), v);
+
+    if (species.has_collision_times()) {
+        auto* times = species.collision_times();
+        t_buffer_.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            t_buffer_[i] = times[particles_[i]];
+        std::copy(t_buffer_.begin(), t_buffer_.end(), times);
+        species.mark_reordered();
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        particles_[i] = i;
+}
+
+template class spark::particle::CellIndex<1, 1>;
+template class spark::particle::CellIndex<1, 3>;
+template class spark::particle::CellIndex<2, 3>;
+template class spark::particle::CellIndex<3, 3>;
@@ -0,0 +1,117 @@
+#include "spark/particle/emitter.h"
+
+#include "log/log.h"
+
+namespace spark::particle::distributions {
+
+Tabulated::Tabulated(std::span<const double> edges, std::span<const double> weights) {
+    if (edges.size() != weights.size() + 1) {
+        SPARK_LOG_ERROR("tabulated distribution of %zu bins with %zu edges", weights.size(),
+                        edges.size());
+        return;
+    }
+
+    bins_ = random::AliasTable(weights);
+    edges_.assign(edges.begin(), edges.end());
+}
+
+template <unsigned N>
+GridDistribution<N>::GridDistribution(const spatial::UniformGrid<N>& grid) : dx_(grid.dx()) {
+    auto n = grid.n();
+    const auto n_nodes = n.arr();
+    size_t stride = 1, n_total_cells = 1;
+    for (int d = static_cast<int>(N) - 1; d >= 0; --d) {
+        if (n_nodes[d] < 2) {
+            SPARK_LOG_ERROR("%s", "grid distribution of a grid with less than 2 nodes per axis");
+            return;
+        }
+        n_cells_[d] = n_nodes[d] - 1;
+        strides_[d] = stride;
+        stride *= n_nodes[d];
+        n_total_cells *= n_cells_[d];
+    }
+
+    const auto* data = grid.data_ptr();
+    nodes_.assign(data, data + grid.n_total());
+
+    std::vector<double> weights(n_total_cells);
+    for (size_t c = 0; c < n_total_cells; ++c) {
+        double sum = 0.0;
+        const size_t first = first_node(c);
+        for (unsigned k = 0; k < n_corners; ++k)
+            sum += nodes_[corner_node(first, k)];
+        weights[c] = sum / n_corners;
+    }
+
+    cells_ = random::AliasTable(weights);
+    integral_ = cells_.total() * dx_.mul();
+}
+
+template <unsigned N>
+core::Vec<N> GridDistribution<N>::value(const double* u) const {
+    double rest;
+    const size_t c = cells_.sample(u[0], rest);
+    const size_t first = first_node(c);
+
+    // Corner of the mixture, with a probability proportional to its value
+    std::array<double, n_corners> corners;
+    double sum = 0.0;
+    for (unsigned k = 0; k < n_corners; ++k) {
+        corners[k] = nodes_[corner_node(first, k)];
+        sum += corners[k];
+    }
+
+    const double target = rest * sum;
+    unsigned corner = 0;
+    for (double acc = corners[0]; corner + 1 < n_corners && acc <= target;)
+        acc += corners[++corner];
+
+    // Along each axis, density 2t towards the corner and 2(1 - t) away from it
+    std::array<double, N> pos;
+    size_t rem = c;
+    for (int d = static_cast<int>(N) - 1; d >= 0; --d) {
+        const double t = std::sqrt(u[d + 1]);
+        const double offset = (corner >> d) & 1u ? t : 1.0 - t;
+        pos[d] = static_cast<double>(rem % n_cells_[d]) + offset;
+        rem /= n_cells_[d];
+    }
+
+    if constexpr (N == 1)
+        return {pos[0] * dx_.x};
+    else if constexpr (N == 2)
+        return {pos[0] * dx_.x, pos[1] * dx_.y};
+    else
+        return {pos[0] * dx_.x, pos[1] * dx_.y, pos[2] * dx_.z};
+}
+
+template <unsigned N>
+void GridDistribution<N>::sample(std::span<core::Vec<N>> values) {
+    const size_t n = values.size();
+    uniforms_.resize(n * (N + 1));
+    random::fill_uniform(uniforms_);
+    for (size_t i = 0; i < n; ++i)
+        values[i] = value(&uniforms_[i * (N + 1)]);
+}
+
+template <unsigned N>
+size_t GridDistribution<N>::first_node(size_t cell) const {
+    size_t first = 0;
+    for (int d = static_cast<int>(N) - 1; d >= 0; --d) {
+        first += (cell % n_cells_[d]) * strides_[d];
+        cell /= n_cells_[d];
+    }
+    return first;
+}
+
+template <unsigned N>
+size_t GridDistribution<N>::corner_node(size_t first, unsigned corner) const {
+    for (unsigned d = 0; d < N; ++d)
+        first += ((corner >> d) & 1u) * strides_[d];
+    return first;
+}
+
+template class GridDistribution<1>;
+template class GridDistribution<2>;
+template class GridDistribution<3>;
+
+}  // namespace spark::particle::distributions
@@ -1,131 +1,79 @@
-
-#include <parallel_hashmap/phmap.h>
-
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
-#include <queue>
+#include <iterator>
+#include <limits>
+#include <utility>
 
+#include "log/log.h"
+#include "spark/constants/constants.h"
 #include "spark/core/vec.h"
 #include "spark/particle/boundary.h"
 #include "spark/spatial/grid.h"
 
-#define SPARK_TILED_BOUNDARY_CHECK_IF_INSIDE
-
 using namespace spark::core;
 
-template <>
-struct std::hash<IntVec<2>> {
-    std::size_t operator()(const IntVec<2>& k) const {
-        using std::hash;
-        using std::size_t;
-        const auto h1 = hash<int>()(k.x);
-        return h1 ^ (hash<int>()(k.y) + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
-    }
-};
-
 namespace {
 
-struct CollisionHit {
-    spark::core::Vec<2> normal;
-    spark::core::Vec<2> pos;
-    uint8_t val = 0;
-};
-
 #define CMOD(idx, size) ((size + (idx % size)) % size)
-#define CMODV(idx, size_vec) CMOD(idx.x, size_vec.x), CMOD(idx.y, size_vec.y)
 
 constexpr size_t padding_ = 4;
 
-int cmod(int idx, int size) {
-    return ((size + (idx % size)) % size);
+// Index of the direction of an axis-aligned unit normal, in the order of the faces of a cell
+int direction_index(const Vec<2>& normal) {
+    if (normal.x != 0.0)
+        return normal.x > 0.0 ? 0 : 1;
+    return normal.y > 0.0 ? 2 : 3;
 }
 
-#define FLOOR_F(x, fp) \
-    int x = int(fp);   \
-    if (x > fp)        \
-        x--;
-
-// Assuming cell size is 1x1
-void grid_raycast(const spark::core::TMatrix<uint8_t, 2>& grid,
-                  const Vec<2>& a,
-                  const Vec<2>& b,
-                  CollisionHit& hit) {
-    hit.val = 0;
-    FLOOR_F(current_index_x, a.x)
-    FLOOR_F(current_index_y, a.y)
-    FLOOR_F(end_index_x, b.x)
-    FLOOR_F(end_index_y, b.y)
-
-    const auto sz = grid.size().to<int>();
-    auto dir = (b - a).normalized();
-
-    Vec<2> t{0.0, 0.0};
-    IntVec<2> step = {0, 0};
-    Vec<2> k = {std::abs(1.0 / dir.x), std::abs(1.0 / dir.y)};
-
-    if (dir.x < 0) {
-        step.x = -1;
-        t.x = (a.x - static_cast<double>(current_index_x)) * k.x;
-    } else {
-        step.x = 1;
-        t.x = (static_cast<double>(current_index_x + 1) - a.x) * k.x;
-    }
-
-    if (dir.y < 0) {
-        step.y = -1;
-        t.y = (a.y - static_cast<double>(current_index_y)) * k.y;
-    } else {
-        step.y = 1;
-        t.y = (static_cast<double>(current_index_y + 1) - a.y) * k.y;
-    }
-
-    double distance = 0.0;
-    Vec<2> normal = {0.0, 0.0};
-
-    while (current_index_x != end_index_x || current_index_y != end_index_y) {
-        if (t.x < t.y) {
-            current_index_x += step.x;
-            distance = t.x;
-            t.x += k.x;
-            normal = {-(double)step.x, 0};
-        } else {
-            current_index_y += step.y;
-            distance = t.y;
-            t.y += k.y;
-            normal = {0, -(double)step.y};
-        }
-
-        const int ki = CMOD(current_index_x, sz.x);
-        const int kj = CMOD(current_index_y, sz.y);
-
-        if (uint8_t val = grid(ki, kj)) {
-            hit.normal = normal;
-            hit.pos = a + dir * distance;
-            hit.val = val;
-            return;
-        }
-    }
+// Key of the face of cell (i, j) in the direction of normal, among n_y cells along y
+uint64_t face_key(int i, int j, const Vec<2>& normal, size_t n_y) {
+    return (static_cast<uint64_t>(i) * n_y + static_cast<uint64_t>(j)) * 4 +
+           static_cast<uint64_t>(direction_index(normal));
 }
 
-inline Vec<2> reflect(const Vec<2>& x, const Vec<2>& n, const Vec<2>& contact) {
-    // Omitting terms:
-    // 1) 2 * n.x * n.y * (contact.y - x.y) in x
-    // 2) 2 * n.x * n.y * (contact.x - x.x) in y
-    // Since they will always be zero if n is axis aligned
-    return {2.0 * (contact.x - x.x) * n.x * n.x + x.x, 2.0 * (contact.y - x.y) * n.y * n.y + x.y};
+// Parameter along the ray of crossing c of the edges of one axis, the first being at t0. Each one
+// is computed from t0 rather than accumulated, so that skipping crossings does not change the
+// following ones. The first is kept apart since 0 * k is not a number when the ray is parallel to
+// the edges.
+double crossing(const double t0, const double k, const int c) {
+    return c == 0 ? t0 : t0 + c * k;
 }
 
-inline Vec<3> reflect(const Vec<3>& v, const Vec<2>& n) {
-    return {v.x * (1.0 - 2.0 * n.x * n.x), v.y * (1.0 - 2.0 * n.y * n.y), v.z};
+// Number of the crossings first, first + 1, ... of an axis, at most max of them, whose parameter
+// is below t, or not above it when inclusive
+int crossings_before(const double t0,
+                     const double k,
+                     const int first,
+                     const int max,
+                     const double t,
+                     const bool inclusive) {
+    int lo = 0, hi = max;
+    while (lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        const double tc = crossing(t0, k, first + mid - 1);
+        if (inclusive ? tc <= t : tc < t)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
 }
+
 }  // namespace
 
 namespace spark::particle {
 TiledBoundary2D::TiledBoundary2D(const spatial::GridProp<2>& grid_prop,
                                  const std::vector<TiledBoundary>& boundaries,
                                  const double dt,
-                                 const bool empty_box)
-    : gprop_(grid_prop), boundaries_(boundaries), dt_(dt), empty_box_(empty_box) {
+                                 const bool empty_box,
+                                 const bool parallel)
+    : gprop_(grid_prop),
+      boundaries_(boundaries),
+      dt_(dt),
+      empty_box_(empty_box),
+      parallel_(parallel) {
     cells_.resize(grid_prop.n + padding_);
     distance_cells_.resize(grid_prop.n);
 
@@ -134,9 +82,16 @@ TiledBoundary2D::TiledBoundary2D(const spatial::GridProp<2>& grid_prop,
     for (uint8_t i = 0; i < boundaries_.size(); ++i) {
         // Add circular_mod
         add_boundary(boundaries_[i], i + 1);
+        const auto type = boundaries_[i].boundary_type;
+        if (type == BoundaryType::Diffuse || type == BoundaryType::Thermal)
+            random_reflections_ = true;
     }
 
+    if (parallel_ && random_reflections_)
+        streams_ = random::StreamPool(random::uniform_u64());
+
     set_distance_cells();
+    set_occupancy();
 }
 
 uint8_t TiledBoundary2D::cell(int i, int j) const {
@@ -166,116 +121,344 @@ void TiledBoundary2D::add_boundary(const TiledBoundary& b, uint8_t id) {
         }
 }
 
-int TiledBoundary2D::bfs_closest_boundary(int i, int j) {
-    phmap::flat_hash_set<IntVec<2>> visited;
-    std::queue<IntVec<2>> to_visit;
-
-    to_visit.push(IntVec<2>{i, j});
-    while (!to_visit.empty()) {
-        auto current = to_visit.front();
-        to_visit.pop();
-
-        if (cell(current.x, current.y)) {
-            return std::abs(current.x - i) + std::abs(current.y - j);
-        }
-
-        if (auto n = IntVec<2>{current.x + 1, current.y}; !visited.contains(n)) {
-            to_visit.push(n);
-            visited.insert(n);
+// Manhattan distance to the closest tile cell on the torus of the cells, as the raycast wraps
+// around it, by a distance transform separated along the axes: along x within each column, then
+// the minimum of these plus the distance along y within each row. Each 1D transform on a ring is
+// a forward and a backward pass, done twice to go around it.
+void TiledBoundary2D::set_distance_cells() {
+    const auto sz = cells_.size();
+    const size_t nx = sz.x, ny = sz.y;
+    const auto* cells = &cells_(0, 0);
+
+    // Large enough for any distance on the torus, small enough not to overflow when incremented
+    constexpr uint32_t far = std::numeric_limits<uint32_t>::max() / 2;
+    std::vector<uint32_t> dist(nx * ny);
+
+    // Along x, sweeping whole rows of a block of columns at a time
+    constexpr size_t block = 256;
+#pragma omp parallel for schedule(static)
+    for (size_t j0 = 0; j0 < ny; j0 += block) {
+        const size_t j1 = std::min(j0 + block, ny);
+        for (size_t i = 0; i < nx; ++i)
+            for (size_t j = j0; j < j1; ++j)
+                dist[i * ny + j] = cells[i * ny + j] ? 0 : far;
+
+        for (int lap = 0; lap < 2; ++lap) {
+            for (size_t i = 0; i < nx; ++i) {
+                const size_t prev = (i + nx - 1) % nx;
+                for (size_t j = j0; j < j1; ++j)
+                    dist[i * ny + j] = std::min(dist[i * ny + j], dist[prev * ny + j] + 1);
+            }
         }
-        if (auto n = IntVec<2>{current.x - 1, current.y}; !visited.contains(n)) {
-            to_visit.push(n);
-            visited.insert(n);
+        for (int lap = 0; lap < 2; ++lap) {
+            for (size_t i = nx; i-- > 0;) {
+                const size_t next = (i + 1) % nx;
+                for (size_t j = j0; j < j1; ++j)
+                    dist[i * ny + j] = std::min(dist[i * ny + j], dist[next * ny + j] + 1);
+            }
         }
-        if (auto n = IntVec<2>{current.x, current.y + 1}; !visited.contains(n)) {
-            to_visit.push(n);
-            visited.insert(n);
+    }
+
+    // Along y within each row, then saturated to the stored type
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < nx; ++i) {
+        uint32_t* row = &dist[i * ny];
+        for (int lap = 0; lap < 2; ++lap) {
+            for (size_t j = 0; j < ny; ++j)
+                row[j] = std::min(row[j], row[(j + ny - 1) % ny] + 1);
         }
-        if (auto n = IntVec<2>{current.x, current.y - 1}; !visited.contains(n)) {
-            to_visit.push(n);
-            visited.insert(n);
+        for (int lap = 0; lap < 2; ++lap) {
+            for (size_t j = ny; j-- > 0;)
+                row[j] = std::min(row[j], row[(j + 1) % ny] + 1);
         }
-    }
 
-    return 0;
+        if (static_cast<int>(i) >= sx_)
+            continue;
+        for (int j = 0; j < sy_; ++j)
+            distance_cells_(i, j) = static_cast<Distance>(
+                std::min<uint32_t>(row[j], std::numeric_limits<Distance>::max()));
+    }
 }
 
-void TiledBoundary2D::set_distance_cells() {
-    for (int i = 0; i < sx_; i++) {
-        for (int j = 0; j < sy_; j++) {
-            distance_cells_(i, j) = bfs_closest_boundary(i, j);
-        }
+void TiledBoundary2D::set_occupancy() {
+    const auto sz = cells_.size();
+    for (size_t level = 0; level < std::size(block_sizes_); ++level) {
+        const auto bs = static_cast<size_t>(block_sizes_[level]);
+        auto& occupancy = occupancy_[level];
+        occupancy.resize({(sz.x + bs - 1) / bs, (sz.y + bs - 1) / bs});
+        for (size_t i = 0; i < sz.x; ++i)
+            for (size_t j = 0; j < sz.y; ++j)
+                if (cells_(i, j))
+                    occupancy(i / bs, j / bs) = 1;
     }
 }
 
-void TiledBoundary2D::apply(Species<2, 3>& species, const Callback& collision_callback) {
-    int n = species.n();
-    auto* x = species.x();
-    auto* v = species.v();
+// Unit-cell DDA over the torus of the cells. Before each step, the largest known empty box
+// around the current cell is found: an empty block of the occupancy levels, or the square
+// inscribed in the ball of the distance field. If the ray ends in it there is no hit, otherwise
+// the crossings of the ray inside it are counted in one go, in the same order as the DDA would
+// take them, so that the walk, and the hit, are the same as without skipping.
+void TiledBoundary2D::raycast(const Vec<2>& a, const Vec<2>& b, detail::CollisionHit& hit) const {
+    hit.val = 0;
+    IntVec<2> current = {detail::floor_index(a.x), detail::floor_index(a.y)};
+    const IntVec<2> end = {detail::floor_index(b.x), detail::floor_index(b.y)};
+    if (current.x == end.x && current.y == end.y)
+        return;
 
-    for (int i = 0; i < n; ++i) {
-        auto& x1 = x[i];
+    const auto sz = cells_.size().to<int>();
+    const auto dir = (b - a).normalized();
+    const Vec<2> k = {std::abs(1.0 / dir.x), std::abs(1.0 / dir.y)};
 
-        if (empty_box_ && (x1.x > 0 && x1.x < gprop_.l.x && x1.y > 0 && x1.y < gprop_.l.y))
-            continue;
+    // Step along each axis and parameter of the first crossing of a cell edge
+    IntVec<2> step;
+    Vec<2> t0;
+    if (dir.x < 0) {
+        step.x = -1;
+        t0.x = (a.x - static_cast<double>(current.x)) * k.x;
+    } else {
+        step.x = 1;
+        t0.x = (static_cast<double>(current.x + 1) - a.x) * k.x;
+    }
 
-        auto& v1 = v[i];
-        const auto x0 = core::Vec<2>{x1.x - v1.x * dt_, x1.y - v1.y * dt_};
+    if (dir.y < 0) {
+        step.y = -1;
+        t0.y = (a.y - static_cast<double>(current.y)) * k.y;
+    } else {
+        step.y = 1;
+        t0.y = (static_cast<double>(current.y + 1) - a.y) * k.y;
+    }
 
-        auto x0_tmp = x0 / gprop_.dx;
-        auto x1_tmp = x1 / gprop_.dx;
+    // Crossings done along each axis, and the current cell wrapped on the torus
+    IntVec<2> crossed = {0, 0};
+    int ki = detail::cmod(current.x, sz.x);
+    int kj = detail::cmod(current.y, sz.y);
+
+    while (current.x != end.x || current.y != end.y) {
+        // Next to the tiles no box is worth skipping, and only the distance is looked up
+        const int d = ki < sx_ && kj < sy_ ? distance_cells_(ki, kj) : 0;
+        if (d > 2) {
+            int block = 0;
+            for (size_t level = std::size(block_sizes_); level-- > 0;) {
+                const int bs = block_sizes_[level];
+                if (!occupancy_[level](ki / bs, kj / bs)) {
+                    block = bs;
+                    break;
+                }
+            }
+            const int half = (d - 1) / 2;
+
+            // Empty box [lo, hi] around the current cell, in unwrapped cells
+            IntVec<2> lo, hi;
+            if (2 * half + 1 > block) {
+                lo = {current.x - half, current.y - half};
+                hi = {current.x + half, current.y + half};
+            } else {
+                lo = {current.x - ki % block, current.y - kj % block};
+                hi = {current.x + std::min(ki - ki % block + block, sz.x) - 1 - ki,
+                      current.y + std::min(kj - kj % block + block, sz.y) - 1 - kj};
+            }
 
-        const auto x0_cell = x0_tmp.apply<std::floor>().to<int>();
-        const auto x1_cell = x1_tmp.apply<std::floor>().to<int>();
+            if (end.x >= lo.x && end.x <= hi.x && end.y >= lo.y && end.y <= hi.y)
+                return;
+
+            // Crossings left in the box along each axis. The ray leaves it by the first of the
+            // next ones, and takes the crossings of the other axis that the DDA would take before.
+            const IntVec<2> inside = {step.x > 0 ? hi.x - current.x : current.x - lo.x,
+                                      step.y > 0 ? hi.y - current.y : current.y - lo.y};
+            const double exit_x = crossing(t0.x, k.x, crossed.x + inside.x);
+            const double exit_y = crossing(t0.y, k.y, crossed.y + inside.y);
+
+            IntVec<2> skipped = inside;
+            if (exit_x < exit_y)
+                skipped.y = crossings_before(t0.y, k.y, crossed.y, inside.y, exit_x, true);
+            else
+                skipped.x = crossings_before(t0.x, k.x, crossed.x, inside.x, exit_y, false);
+
+            if (skipped.x > 0 || skipped.y > 0) {
+                crossed = {crossed.x + skipped.x, crossed.y + skipped.y};
+                current = {current.x + step.x * skipped.x, current.y + step.y * skipped.y};
+                ki = detail::cmod(current.x, sz.x);
+                kj = detail::cmod(current.y, sz.y);
+            }
+        }
 
-        const uint8_t distance_to_boundary = distance_cells_(x0_cell.x, x0_cell.y);
-        if (std::abs(x0_cell.x - x1_cell.x) + std::abs(x0_cell.y - x1_cell.y) <
-            distance_to_boundary)
-            continue;
+        const double tx = crossing(t0.x, k.x, crossed.x);
+        const double ty = crossing(t0.y, k.y, crossed.y);
+        double distance;
+        Vec<2> normal;
+        if (tx < ty) {
+            current.x += step.x;
+            ki = ki + step.x == sz.x ? 0 : (ki + step.x < 0 ? sz.x - 1 : ki + step.x);
+            crossed.x++;
+            distance = tx;
+            normal = {-static_cast<double>(step.x), 0.0};
+        } else {
+            current.y += step.y;
+            kj = kj + step.y == sz.y ? 0 : (kj + step.y < 0 ? sz.y - 1 : kj + step.y);
+            crossed.y++;
+            distance = ty;
+            normal = {0.0, -static_cast<double>(step.y)};
+        }
 
-#ifdef SPARK_TILED_BOUNDARY_CHECK_IF_INSIDE
-        // If particle is inside wall, remove it to avoid errors
-        if (distance_to_boundary == 0) {
-            species.remove(i);
-            i--;
-            n--;
-            continue;
+        if (const uint8_t val = cells_(ki, kj)) {
+            hit.normal = normal;
+            hit.pos = a + dir * distance;
+            hit.val = val;
+            hit.cell_x = ki;
+            hit.cell_y = kj;
+            return;
+        }
+    }
+}
+
+std::vector<BoundaryFace> TiledBoundary2D::exposed_faces(const int boundary) const {
+    std::vector<BoundaryFace> faces;
+    if (boundary < 0 || static_cast<size_t>(boundary) >= boundaries_.size())
+        return faces;
+
+    const auto& b = boundaries_[boundary];
+    const int imin = std::max(std::min(b.lower_left.x, b.upper_right.x), 0);
+    const int imax = std::min(std::max(b.lower_left.x, b.upper_right.x), sx_ - 1);
+    const int jmin = std::max(std::min(b.lower_left.y, b.upper_right.y), 0);
+    const int jmax = std::min(std::max(b.lower_left.y, b.upper_right.y), sy_ - 1);
+    const auto id = static_cast<uint8_t>(boundary + 1);
+    const auto dx = gprop_.dx;
+
+    constexpr IntVec<2> directions[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (int i = imin; i <= imax; ++i) {
+        for (int j = jmin; j <= jmax; ++j) {
+            // Cells overwritten by a later tile belong to it
+            if (cell(i, j) != id)
+                continue;
+
+            for (const auto& d : directions) {
+                const int ni = i + d.x, nj = j + d.y;
+                if (ni < 0 || ni >= sx_ || nj < 0 || nj >= sy_ || cell(ni, nj))
+                    continue;
+
+                // The face is the side of cell (i, j) towards the neighbour, oriented so that the
+                // normal is on its right
+                const Vec<2> normal = {static_cast<double>(d.x), static_cast<double>(d.y)};
+                const Vec<2> tangent = {-normal.y * dx.x, normal.x * dx.y};
+                const Vec<2> center = {(i + 0.5 + 0.5 * d.x) * dx.x, (j + 0.5 + 0.5 * d.y) * dx.y};
+                faces.push_back({center - tangent * 0.5, tangent, normal, boundary});
+            }
         }
-#endif
+    }
 
-        CollisionHit hit{0};
+    return faces;
+}
 
-        while (true) {
-            grid_raycast(cells_, x0_tmp, x1_tmp, hit);
+void TiledBoundary2D::enable_counters(const WallCountersConfig& config) {
+    counters_enabled_ = true;
+    counters_config_ = config;
+    if (config.n_energy_bins > 0 && !(config.max_energy > 0.0)) {
+        SPARK_LOG_WARN("%s", "energy histogram of the wall counters without a maximum energy");
+        counters_config_.n_energy_bins = 0;
+    }
 
-            // val == 0 means that no boundary was found
-            if (!hit.val)
-                break;
+    counted_faces_.clear();
+    face_keys_.clear();
+    face_ids_.clear();
+    if (config.per_face) {
+        for (size_t b = 0; b < boundaries_.size(); ++b) {
+            const auto faces = exposed_faces(static_cast<int>(b));
+            counted_faces_.insert(counted_faces_.end(), faces.begin(), faces.end());
+        }
+
+        // Faces sorted by key, for the lookup of the face of a hit
+        const size_t n_y = cells_.size().y;
+        std::vector<std::pair<uint64_t, uint32_t>> keyed(counted_faces_.size());
+        for (size_t f = 0; f < counted_faces_.size(); ++f) {
+            const auto& face = counted_faces_[f];
+            const auto c = (face.origin + face.tangent * 0.5) / gprop_.dx - face.normal * 0.5;
+            const auto cell = c.apply<std::floor>().to<int>();
+            keyed[f] = {face_key(cell.x, cell.y, face.normal, n_y), static_cast<uint32_t>(f)};
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (const auto& [key, id] : keyed) {
+            face_keys_.push_back(key);
+            face_ids_.push_back(id);
+        }
+    }
 
-            const auto& b = boundaries_[hit.val - 1];
-            const auto btype = b.boundary_type;
+    chunk_counters_.assign(1, empty_counters());
+}
 
-            if (collision_callback) {
-                collision_callback(hit.val - 1, x1, v1);
-            }
+WallCounters TiledBoundary2D::empty_counters() const {
+    const size_t n_boundaries = boundaries_.size();
+    WallCounters counters;
+    counters.hits.assign(n_boundaries, 0);
+    counters.energy.assign(n_boundaries, 0.0);
+    counters.face_hits.assign(counted_faces_.size(), 0);
+    counters.face_energy.assign(counted_faces_.size(), 0.0);
+    counters.angle_histogram.assign(n_boundaries * counters_config_.n_angle_bins, 0);
+    counters.energy_histogram.assign(n_boundaries * counters_config_.n_energy_bins, 0);
+    return counters;
+}
 
-            if (btype == BoundaryType::Absorbing) {
-                // TODO(lui): Check if this is OK
-                species.remove(i);
-                i--;  // check ith particle again since the particle is replaced during removal
-                n--;  // decrease the number of particles
-                break;
-            } else if (btype == BoundaryType::Specular) {
-                // Specular reflection
-                x1 = reflect(x1, hit.normal, hit.pos * gprop_.dx);
-                v1 = reflect(v1, hit.normal);
-
-                x1_tmp = x1 / gprop_.dx;
-                x0_tmp = hit.pos;
-            }
+WallCounters TiledBoundary2D::counters() const {
+    WallCounters total = empty_counters();
+    for (const auto& counters : chunk_counters_)
+        total.merge(counters);
+    return total;
+}
 
-            // TODO(lui): Implement diffuse (Lambertian) reflection
+void TiledBoundary2D::reset_counters() {
+    for (auto& counters : chunk_counters_)
+        counters.clear();
+}
+
+void TiledBoundary2D::record(WallCounters& counters,
+                             const detail::CollisionHit& hit,
+                             const Vec<3>& v,
+                             const double m) const {
+    const size_t b = hit.val - 1;
+    const double v2 = v.x * v.x + v.y * v.y + v.z * v.z;
+    const double energy = 0.5 * m * v2 / constants::e;
+
+    counters.hits[b]++;
+    counters.energy[b] += energy;
+
+    if (!face_keys_.empty()) {
+        const uint64_t key = face_key(hit.cell_x, hit.cell_y, hit.normal, cells_.size().y);
+        const auto it = std::lower_bound(face_keys_.begin(), face_keys_.end(), key);
+        // Faces that are not exposed, e.g. on the edge of the domain, are not counted
+        if (it != face_keys_.end() && *it == key) {
+            const uint32_t f = face_ids_[it - face_keys_.begin()];
+            counters.face_hits[f]++;
+            counters.face_energy[f] += energy;
         }
     }
+
+    if (const size_t n_bins = counters_config_.n_angle_bins; n_bins > 0 && v2 > 0.0) {
+        const double vn = std::abs(v.x * hit.normal.x + v.y * hit.normal.y);
+        const double angle = std::acos(std::min(vn / std::sqrt(v2), 1.0));
+        const double k = angle / (0.5 * constants::pi) * static_cast<double>(n_bins);
+        counters.angle_histogram[b * n_bins + std::min(static_cast<size_t>(k), n_bins - 1)]++;
+    }
+
+    if (const size_t n_bins = counters_config_.n_energy_bins; n_bins > 0) {
+        const double scale = static_cast<double>(n_bins) / counters_config_.max_energy;
+        const double k = std::min(energy * scale, static_cast<double>(n_bins - 1));
+        counters.energy_histogram[b * n_bins + static_cast<size_t>(k)]++;
+    }
+}
+
+void TiledBoundary2D::apply(Species<2, 3>& species) {
+    const NoCallback none;
+    apply_impl(species, none);
+}
+
+void TiledBoundary2D::apply(Species<2, 3>& species, const Callback& collision_callback) {
+    if (!collision_callback) {
+        apply(species);
+        return;
+    }
+
+    auto on_hit = [&collision_callback](int boundary, const Vec<2>& x, const Vec<3>& v) {
+        collision_callback(boundary, x, v);
+    };
+    apply_impl(species, on_hit);
 }
 }  // namespace spark::particle
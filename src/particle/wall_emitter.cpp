@@ -0,0 +1,96 @@
+#include "spark/particle/wall_emitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "log/log.h"
+#include "spark/constants/constants.h"
+
+namespace spark::particle {
+
+WallEmitter::WallEmitter(const double rate,
+                         std::vector<BoundaryFace> faces,
+                         const WallEmitterConfig& config)
+    : Emitter<2, 3>(rate), faces_(std::move(faces)), config_(config) {
+    if (faces_.empty()) {
+        SPARK_LOG_ERROR("%s", "wall emitter without exposed faces");
+        return;
+    }
+
+    std::vector<double> areas(faces_.size());
+    double min_area = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < faces_.size(); ++i) {
+        areas[i] = faces_[i].tangent.norm();
+        min_area = std::min(min_area, areas[i]);
+    }
+
+    faces_table_ = random::AliasTable(areas);
+    offset_ = 1e-6 * min_area;
+}
+
+WallEmitter::WallEmitter(const double rate,
+                         TiledBoundary2D& tiles,
+                         const int boundary,
+                         const WallEmitterConfig& config)
+    : WallEmitter(rate, tiles.exposed_faces(boundary), config) {
+    tiles_ = &tiles;
+}
+
+void WallEmitter::emit(Species<2, 3>& species, const double n) {
+    const size_t np = detail::n_emitted(n);
+    if (np == 0 || faces_.empty())
+        return;
+
+    const double m = species.m();
+    const double vth = std::sqrt(constants::e * config_.temperature / m);
+    const distributions::MaxwellFlux flux{vth, 0.0};
+
+    const size_t first = species.n();
+    species.add(np);
+
+    // Per particle: face and position along it, fraction of the step, normal and tangential
+    // velocities
+    uniforms_.resize(2 * np);
+    random::fill_uniform(uniforms_);
+    normal_.resize(np);
+    flux.sample(normal_);
+    tangential_.resize(2 * np);
+    random::fill_normal(tangential_);
+
+    auto* x = species.x() + first;
+    auto* v = species.v() + first;
+    const auto on_hit = [this](int boundary, const core::Vec<2>& pos, const core::Vec<3>& vel) {
+        on_hit_(boundary, pos, vel);
+    };
+
+    removed_.clear();
+    for (size_t i = 0; i < np; ++i) {
+        double along;
+        const auto& face = faces_[faces_table_.sample(uniforms_[2 * i], along)];
+        const core::Vec<2> t = {-face.normal.y, face.normal.x};
+        const double vn = normal_[i];
+        const double vt = vth * tangential_[2 * i];
+
+        // 1 - u is in (0, 1], so that no particle is left on the wall
+        const double push = config_.dt * (1.0 - uniforms_[2 * i + 1]);
+        v[i] = {face.normal.x * vn + t.x * vt, face.normal.y * vn + t.y * vt,
+                vth * tangential_[2 * i + 1]};
+        const auto start = face.origin + face.tangent * along + face.normal * offset_;
+        x[i] = start + face.normal * (vn * push) + t * (vt * push);
+
+        // The push may cross other tiles, e.g. at concave corners or thin features
+        if (tiles_ && push > 0.0) {
+            const bool removed = on_hit_ ? tiles_->move(start, x[i], v[i], push, m, on_hit)
+                                         : tiles_->move(start, x[i], v[i], push, m);
+            if (removed)
+                removed_.push_back(first + i);
+        }
+    }
+
+    // Descending, so that the swap with the last particle never moves another removed one
+    for (auto it = removed_.rbegin(); it != removed_.rend(); ++it)
+        species.remove(*it);
+}
+
+}  // namespace spark::particle
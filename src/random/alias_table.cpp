@@ -0,0 +1,63 @@
+#include "spark/random/alias_table.h"
+
+#include <cmath>
+#include <limits>
+
+#include "log/log.h"
+
+namespace spark::random {
+
+AliasTable::AliasTable(std::span<const double> weights) {
+    const size_t n = weights.size();
+    if (n == 0 || n > std::numeric_limits<uint32_t>::max()) {
+        SPARK_LOG_ERROR("alias table of %zu entries", n);
+        return;
+    }
+
+    total_ = 0.0;
+    for (const double w : weights) {
+        if (!(w >= 0.0) || !std::isfinite(w)) {
+            SPARK_LOG_ERROR("%s", "alias table weights must be finite and non-negative");
+            total_ = 0.0;
+            return;
+        }
+        total_ += w;
+    }
+
+    if (total_ <= 0.0) {
+        SPARK_LOG_ERROR("%s", "alias table weights sum to zero");
+        return;
+    }
+
+    // Weights scaled to a mean of 1, split in the entries under and over it
+    prob_.resize(n);
+    alias_.resize(n);
+    std::vector<uint32_t> small, large;
+    const double scale = static_cast<double>(n) / total_;
+    for (size_t i = 0; i < n; ++i) {
+        prob_[i] = weights[i] * scale;
+        alias_[i] = static_cast<uint32_t>(i);
+        (prob_[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    // Each small entry is filled up to 1 by a large one, which keeps the remainder
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        const uint32_t l = large.back();
+        small.pop_back();
+        alias_[s] = l;
+        prob_[l] -= 1.0 - prob_[s];
+        if (prob_[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // What is left is 1 up to rounding errors
+    for (const uint32_t i : large)
+        prob_[i] = 1.0;
+    for (const uint32_t i : small)
+        prob_[i] = 1.0;
+}
+
+}  // namespace spark::random
@@ -15,7 +15,8 @@ See <http://creativecommons.org/publicdomain/zero/1.0/>. */
    It is a very fast generator passing BigCrush, and it can be useful if
    for some reason you absolutely want 64 bits of state. */
 
-static uint64_t x; /* The state can be seeded with any value. */
+// spark: the state is thread_local so that each thread owns an independent stream
+static thread_local uint64_t x; /* The state can be seeded with any value. */
 
 uint64_t next() {
 	uint64_t z = (x += 0x9e3779b97f4a7c15);
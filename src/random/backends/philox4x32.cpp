@@ -0,0 +1,62 @@
+#ifdef KN_RANDOM_USE_PHILOX
+
+#include "spark/random/random.h"
+#include "spark/random/philox.h"
+
+namespace
+{
+    // Keyed stream of the free functions, owned by each thread. initialize() sets the key and
+    // restarts the counter.
+    thread_local spark::random::PhiloxStream stream;
+}
+
+namespace spark::random
+{
+    void initialize(uint64_t seed)
+    {
+        stream = PhiloxStream(Philox(seed), 0, 0);
+    }
+
+    uint64_t uniform_u64()
+    {
+        return stream.uniform_u64();
+    }
+
+    double uniform()
+    {
+        return stream.uniform();
+    }
+
+    double normal()
+    {
+        return stream.normal();
+    }
+
+    void fill_uniform(std::span<double> values)
+    {
+        stream.fill_uniform(values);
+    }
+
+    void fill_normal(std::span<double> values)
+    {
+        stream.fill_normal(values);
+    }
+
+    // The key, step, id and position of the thread's stream are saved, and the stream is
+    // rekeyed from the bound one
+    ScopedStream::ScopedStream(Generator& bound)
+        : stream_(&bound),
+          saved_{stream.philox().seed(), stream.id(),
+                 static_cast<uint64_t>(stream.step()) << 32 | stream.position(), 0}
+    {
+        stream = PhiloxStream(Philox(bound.uniform_u64()), 0, 0);
+    }
+
+    ScopedStream::~ScopedStream()
+    {
+        stream = PhiloxStream(Philox(saved_[0]), static_cast<uint32_t>(saved_[2] >> 32), saved_[1]);
+        stream.set_position(static_cast<uint32_t>(saved_[2]));
+    }
+}
+
+#endif
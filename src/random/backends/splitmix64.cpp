@@ -30,6 +30,28 @@ namespace spark::random
         #endif 
     }
 
+    void fill_uniform(std::span<double> values)
+    {
+        for (auto& value : values)
+            value = uniform();
+    }
+
+    void fill_normal(std::span<double> values)
+    {
+        for (auto& value : values)
+            value = normal();
+    }
+
+    // The single word of state is saved, and the thread's generator reseeded from the stream
+    ScopedStream::ScopedStream(Generator& stream) : stream_(&stream), saved_{_splitmix64::x}
+    {
+        _splitmix64::x = stream.uniform_u64();
+    }
+
+    ScopedStream::~ScopedStream()
+    {
+        _splitmix64::x = saved_[0];
+    }
 }
 
 #endif
\ No newline at end of file
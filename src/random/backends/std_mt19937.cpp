@@ -6,10 +6,10 @@
 
 namespace _std_mt19937_64
 {
-    std::mt19937_64 gen;
-    std::uniform_real_distribution<double> uniform(0.0, 1.0);
-    std::uniform_int_distribution<uint64_t> uniform_u64;
-    std::normal_distribution<double> normal;
+    thread_local std::mt19937_64 gen;
+    thread_local std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    thread_local std::uniform_int_distribution<uint64_t> uniform_u64;
+    thread_local std::normal_distribution<double> normal;
 }
 
 namespace spark::random
@@ -33,6 +33,30 @@ namespace spark::random
     {
         return _std_mt19937_64::normal(_std_mt19937_64::gen);
     }
+
+    void fill_uniform(std::span<double> values)
+    {
+        for (auto& value : values)
+            value = uniform();
+    }
+
+    void fill_normal(std::span<double> values)
+    {
+        for (auto& value : values)
+            value = normal();
+    }
+
+    // The thread's generator is reseeded from the stream, and afterwards from a seed drawn from
+    // its own sequence, since the state of MT19937 is too large to be saved per scope
+    ScopedStream::ScopedStream(Generator& stream) : stream_(&stream), saved_{uniform_u64()}
+    {
+        _std_mt19937_64::gen.seed(stream.uniform_u64());
+    }
+
+    ScopedStream::~ScopedStream()
+    {
+        _std_mt19937_64::gen.seed(saved_[0]);
+    }
 }
 
 #endif
\ No newline at end of file
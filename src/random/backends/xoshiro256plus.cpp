@@ -2,44 +2,56 @@
 
 #include "spark/random/random.h"
 
-namespace _xoshiro256plus
-{
-    #include "external/xoshiro256plus.c"   
-}
+#include "../ziggurat.h"
 
-namespace _splitmix64
+namespace
 {
-    #include "external/splitmix64.c"
+    // Generator of the free functions, owned by each thread
+    thread_local spark::random::Generator generator;
 }
 
 namespace spark::random
 {
     void initialize(uint64_t seed)
     {
-        // splitmix64 is used to seed xoshiro256+ as was advised by its authors
-        _splitmix64::x = seed;
-
-        _xoshiro256plus::s[0] = _splitmix64::next();
-        _xoshiro256plus::s[1] = _splitmix64::next();
-        _xoshiro256plus::s[2] = _splitmix64::next();
-        _xoshiro256plus::s[3] = _splitmix64::next();
+        generator.seed(seed);
     }
 
     uint64_t uniform_u64()
     {
-        return _xoshiro256plus::next();
+        return generator.uniform_u64();
     }
 
-    #define RANDOM_USE_SIMPLE_DOUBLE_CONVERSION
     double uniform()
-    {   
-        #ifdef RANDOM_USE_SIMPLE_DOUBLE_CONVERSION
-        return (_xoshiro256plus::next() >> 11) * 0x1.0p-53;
-        #else
-        const union { uint64_t i; double d; } u = { .i = UINT64_C(0x3FF) << 52 | _xoshiro256plus::next() >> 12 };
-        return u.d - 1.0;
-        #endif 
+    {
+        return generator.uniform();
+    }
+
+    double normal()
+    {
+        return ziggurat::normal(generator);
+    }
+
+    void fill_uniform(std::span<double> values)
+    {
+        generator.fill_uniform(values);
+    }
+
+    void fill_normal(std::span<double> values)
+    {
+        generator.fill_normal(values);
+    }
+
+    ScopedStream::ScopedStream(Generator& stream) : stream_(&stream), saved_(generator.state())
+    {
+        generator.set_state(stream.state());
+    }
+
+    ScopedStream::~ScopedStream()
+    {
+        stream_->set_state(generator.state());
+        generator.set_state(saved_);
     }
 }
 
-#endif
\ No newline at end of file
+#endif
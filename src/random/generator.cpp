@@ -0,0 +1,158 @@
+#include "spark/random/generator.h"
+
+#include <algorithm>
+
+#include "simd.h"
+#include "ziggurat.h"
+
+namespace {
+
+using spark::random::Generator;
+
+// Interleaved xoshiro256+ generators, stored by state word so that a step of all lanes is a few
+// SIMD instructions per word
+constexpr size_t n_lanes = 8;
+
+// Below this size, seeding the lanes costs more than the scalar draws
+constexpr size_t min_lane_fill = 64;
+
+struct Lanes {
+    alignas(64) uint64_t s0[n_lanes];
+    alignas(64) uint64_t s1[n_lanes];
+    alignas(64) uint64_t s2[n_lanes];
+    alignas(64) uint64_t s3[n_lanes];
+
+    // Each lane is seeded with a draw of the parent, as an independent xoshiro256+ seed
+    explicit Lanes(Generator& parent) {
+        for (size_t k = 0; k < n_lanes; ++k) {
+            const auto s = Generator(parent.uniform_u64()).state();
+            s0[k] = s[0];
+            s1[k] = s[1];
+            s2[k] = s[2];
+            s3[k] = s[3];
+        }
+    }
+
+    void next(uint64_t* out) {
+#pragma omp simd
+        for (size_t k = 0; k < n_lanes; ++k) {
+            out[k] = s0[k] + s3[k];
+            const uint64_t t = s1[k] << 17;
+            s2[k] ^= s0[k];
+            s3[k] ^= s1[k];
+            s1[k] ^= s2[k];
+            s0[k] ^= s3[k];
+            s2[k] ^= t;
+            s3[k] = (s3[k] << 45) | (s3[k] >> 19);
+        }
+    }
+};
+
+SPARK_RANDOM_SIMD_CLONES
+void fill_uniform_lanes(Generator& parent, double* values, size_t n) {
+    Lanes lanes(parent);
+    alignas(64) uint64_t r[n_lanes];
+
+    for (size_t begin = 0; begin < n; begin += n_lanes) {
+        lanes.next(r);
+        const size_t m = std::min(n_lanes, n - begin);
+        double* out = values + begin;
+#pragma omp simd
+        for (size_t k = 0; k < m; ++k)
+            out[k] = spark::random::simd::to_uniform(r[k]);
+    }
+}
+
+SPARK_RANDOM_SIMD_CLONES
+void fill_normal_lanes(Generator& parent, double* values, size_t n) {
+    Lanes lanes(parent);
+    alignas(64) uint64_t r[n_lanes];
+
+    for (size_t begin = 0; begin < n; begin += n_lanes) {
+        lanes.next(r);
+        spark::random::simd::to_normal<n_lanes>(r, values + begin, std::min(n_lanes, n - begin),
+                                                parent);
+    }
+}
+
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// Advances the state as the polynomial of the jump, following the reference implementation
+void jump_state(spark::random::Generator& gen, const uint64_t (&poly)[4]) {
+    spark::random::Generator::State s = {0, 0, 0, 0};
+    for (const uint64_t word : poly) {
+        for (int b = 0; b < 64; ++b) {
+            if (word & (uint64_t{1} << b)) {
+                const auto& g = gen.state();
+                s[0] ^= g[0];
+                s[1] ^= g[1];
+                s[2] ^= g[2];
+                s[3] ^= g[3];
+            }
+            gen.uniform_u64();
+        }
+    }
+    gen.set_state(s);
+}
+
+}  // namespace
+
+namespace spark::random {
+
+void Generator::seed(uint64_t seed) {
+    for (auto& s : s_)
+        s = splitmix64(seed);
+}
+
+void Generator::jump() {
+    static constexpr uint64_t poly[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                        0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+    jump_state(*this, poly);
+}
+
+void Generator::long_jump() {
+    static constexpr uint64_t poly[] = {0x76e15d3efefdcbbf, 0xc5004e441c522fb3,
+                                        0x77710069854ee241, 0x39109bb02acbe635};
+    jump_state(*this, poly);
+}
+
+double Generator::normal() {
+    return ziggurat::normal(*this);
+}
+
+void Generator::fill_uniform(std::span<double> values) {
+    if (values.size() < min_lane_fill) {
+        for (auto& value : values)
+            value = uniform();
+    } else {
+        fill_uniform_lanes(*this, values.data(), values.size());
+    }
+}
+
+void Generator::fill_normal(std::span<double> values) {
+    if (values.size() < min_lane_fill) {
+        for (auto& value : values)
+            value = normal();
+    } else {
+        fill_normal_lanes(*this, values.data(), values.size());
+    }
+}
+
+StreamPool::StreamPool(uint64_t seed, size_t n_streams) : next_(seed) {
+    resize(n_streams);
+}
+
+void StreamPool::resize(size_t n) {
+    streams_.reserve(n);
+    while (streams_.size() < n) {
+        streams_.push_back(next_);
+        next_.jump();
+    }
+}
+
+}  // namespace spark::random
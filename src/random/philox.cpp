@@ -0,0 +1,59 @@
+#include "spark/random/philox.h"
+
+#include <algorithm>
+
+#include "simd.h"
+#include "ziggurat.h"
+
+namespace {
+
+using spark::random::Philox;
+
+// Words of a vectorized step, from 16 counters
+constexpr size_t block_words = 32;
+
+SPARK_RANDOM_SIMD_CLONES
+void philox_words(const Philox& philox, uint32_t step, uint64_t id, uint32_t first, uint64_t* r) {
+#pragma omp simd
+    for (uint32_t k = 0; k < block_words / 2; ++k)
+        philox.words(step, id, first + k, r[2 * k], r[2 * k + 1]);
+}
+
+}  // namespace
+
+namespace spark::random {
+
+double PhiloxStream::normal() {
+    return ziggurat::normal(*this);
+}
+
+void PhiloxStream::fill_uniform(std::span<double> values) {
+    const size_t size = values.size();
+    alignas(64) uint64_t r[block_words];
+    for (size_t i = 0; i < size;) {
+        align();
+        const size_t m = std::min(block_words, size - i);
+        philox_words(philox_, step_, id_, position_ / 2, r);
+        set_position(position_ + static_cast<uint32_t>(m));
+#pragma omp simd
+        for (size_t k = 0; k < m; ++k)
+            values[i + k] = simd::to_uniform(r[k]);
+        i += m;
+    }
+}
+
+void PhiloxStream::fill_normal(std::span<double> values) {
+    const size_t size = values.size();
+    alignas(64) uint64_t r[block_words];
+    for (size_t i = 0; i < size;) {
+        // The position is advanced first, so that rejected attempts are drawn anew after the block
+        align();
+        const size_t m = std::min(block_words, size - i);
+        philox_words(philox_, step_, id_, position_ / 2, r);
+        set_position(position_ + static_cast<uint32_t>(m));
+        simd::to_normal<block_words>(r, values.data() + i, m, *this);
+        i += m;
+    }
+}
+
+}  // namespace spark::random
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "ziggurat.h"
+
+// Conversions of blocks of random words for the vectorized fills. The kernels using them are
+// compiled for AVX-512, AVX2 and the baseline, and the one matching the CPU is selected at load
+// time.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+#define SPARK_RANDOM_SIMD_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define SPARK_RANDOM_SIMD_CLONES
+#endif
+
+namespace spark::random::simd {
+
+// Uniform double in [0,1) from the upper 52 bits, through the mantissa of [1,2), which needs no
+// integer conversion (missing for 64-bit integers before AVX-512)
+inline double to_uniform(uint64_t r) {
+    return std::bit_cast<double>(UINT64_C(0x3FF) << 52 | r >> 12) - 1.0;
+}
+
+// Standard normal doubles from m <= N random words, with the vectorized fast path of the ziggurat
+// (99.3% of the draws). Attempts outside the core of their layer are completed with the scalar
+// edge sampler, and drawn anew from gen if rejected.
+template <size_t N, typename G>
+inline void to_normal(const uint64_t* r, double* out, size_t m, G& gen) {
+    alignas(64) uint64_t rejected[N];
+
+#pragma omp simd
+    for (size_t k = 0; k < m; ++k) {
+        const uint64_t idx = r[k] & 0xff;
+        const uint64_t sign = (r[k] >> 8) & 0x1;
+        const uint64_t rabs = (r[k] >> 9) & 0x000fffffffffffff;
+        // rabs < 2^52 converts exactly through the mantissa of 2^52
+        const double x = (std::bit_cast<double>(rabs | UINT64_C(0x4330000000000000)) - 0x1.0p52) *
+                         ziggurat::wi_double[idx];
+        out[k] = sign ? -x : x;
+        rejected[k] = rabs >= ziggurat::ki_double[idx];
+    }
+
+    for (size_t k = 0; k < m; ++k) {
+        if (rejected[k] && !ziggurat::sample_edge(gen, static_cast<int>(r[k] & 0xff),
+                                                  (r[k] >> 9) & 0x000fffffffffffff, out[k]))
+            out[k] = ziggurat::normal(gen);
+    }
+}
+
+}  // namespace spark::random::simd